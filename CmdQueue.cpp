@@ -0,0 +1,131 @@
+#include <string.h>
+
+#include "CmdQueue.h"
+
+CmdQueue::CmdQueue() {
+  memset(&metrics, 0, sizeof(metrics));
+  pushed = 0;
+  collected = 0;
+
+  for (int i = 0; i < CMDQUEUE_MAX_ACTUATORS; i++) {
+    isPending[i] = false;
+    isHeld[i] = false;
+    credit[i] = CMDQUEUE_BURST * 1000UL;
+    lastRefill[i] = 0;
+    rateLimited[i] = 0;
+  }
+}
+
+bool CmdQueue::push(const s_command& cmd) {
+  if (cmd.ActuatorId >= CMDQUEUE_MAX_ACTUATORS) {
+    countMalformed();
+    return false;
+  }
+
+  metrics.received++;
+
+  if (!fifo.push(cmd)) {
+    metrics.queueFull++;
+    return false;
+  }
+
+  pushed++;
+  return true;
+}
+
+void CmdQueue::countMalformed() {
+  metrics.malformed++;
+}
+
+void CmdQueue::collect() {
+  s_command cmd;
+  while (fifo.pop(cmd)) {
+    collected++;
+    if (isPending[cmd.ActuatorId]) {
+      metrics.coalesced++; // Last target wins
+    }
+    pending[cmd.ActuatorId] = cmd;
+    isPending[cmd.ActuatorId] = true;
+    isHeld[cmd.ActuatorId] = false;
+  }
+}
+
+bool CmdQueue::pop(s_command& cmd, unsigned long now) {
+  for (int i = 0; i < CMDQUEUE_MAX_ACTUATORS; i++) {
+    if (!isPending[i]) {
+      continue;
+    }
+
+    if (!takeToken(i, now)) {
+      // Keep it in its slot : a newer command replaces it, else applied later
+      if (!isHeld[i]) {
+        isHeld[i] = true;
+        rateLimited[i]++;
+        metrics.rateLimited++;
+      }
+      continue;
+    }
+
+    cmd = pending[i];
+    isPending[i] = false;
+    isHeld[i] = false;
+    metrics.applied++;
+    return true;
+  }
+  return false;
+}
+
+bool CmdQueue::hasPending() {
+  if (!fifo.isEmpty()) {
+    return true;
+  }
+  for (int i = 0; i < CMDQUEUE_MAX_ACTUATORS; i++) {
+    if (isPending[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+uint32_t CmdQueue::getPushed() {
+  return pushed;
+}
+
+uint32_t CmdQueue::getCollected() {
+  return collected;
+}
+
+const s_cmdMetrics& CmdQueue::getMetrics() {
+  return metrics;
+}
+
+uint32_t CmdQueue::getRateLimited(int actuatorId) {
+  if (actuatorId < 0 || actuatorId >= CMDQUEUE_MAX_ACTUATORS) {
+    return 0;
+  }
+  return rateLimited[actuatorId];
+}
+
+// Privates
+bool CmdQueue::takeToken(int actuatorId, unsigned long now) {
+  const uint32_t full = CMDQUEUE_BURST * 1000UL;
+  unsigned long elapsed = now - lastRefill[actuatorId];
+  lastRefill[actuatorId] = now;
+
+  // Refill, one command every 1000 / CMDQUEUE_RATE ms
+  if (elapsed >= full / CMDQUEUE_RATE) {
+    credit[actuatorId] = full;
+  } else {
+    credit[actuatorId] += elapsed * CMDQUEUE_RATE;
+    if (credit[actuatorId] > full) {
+      credit[actuatorId] = full;
+    }
+  }
+
+  if (credit[actuatorId] < 1000) {
+    return false;
+  }
+
+  credit[actuatorId] -= 1000;
+  return true;
+}
@@ -0,0 +1,91 @@
+#ifndef CMDQUEUE_H
+#define CMDQUEUE_H
+
+#include <stdint.h>
+
+#include "SpscQueue.h"
+
+#ifndef CMDQUEUE_MAX_ACTUATORS
+#define CMDQUEUE_MAX_ACTUATORS 16 // one pending slot and one rate limit per actuator
+#endif
+#ifndef CMDQUEUE_FIFO_SIZE
+#define CMDQUEUE_FIFO_SIZE 16 // network -> I/O, power of two
+#endif
+#ifndef CMDQUEUE_RATE
+#define CMDQUEUE_RATE 5 // commands applied per second, per actuator
+#endif
+#ifndef CMDQUEUE_BURST
+#define CMDQUEUE_BURST 10 // commands applied at once, per actuator
+#endif
+
+enum e_command { cOPEN, cCLOSE, cSTOP, cPOSITION, cON, cOFF };
+
+// Command record : network -> I/O
+struct s_command {
+  uint8_t ActuatorId;
+  e_command Cmd;
+  int16_t Value; // position 0-100 for cPOSITION
+};
+
+// Counters, each one is written by one side only
+struct s_cmdMetrics {
+  uint32_t received;    // network : offered to the queue
+  uint32_t queueFull;   // network : refused, fifo full
+  uint32_t malformed;   // network : bad topic or payload
+  uint32_t rateLimited; // I/O : held in its slot by the actuator rate limit, applied later
+  uint32_t coalesced;   // I/O : replaced by a newer command before being applied
+  uint32_t applied;     // I/O : handed to the actuator
+};
+
+////////////////////////////////////////////////////////////////////////
+// Inbound command queue
+// The network side pushes parsed commands into a lock-free fifo. The I/O
+// side collects them into one slot per actuator, so only the last target
+// is kept, and pops them at tick time. The rate limit (token bucket per
+// actuator) only delays a slot : a newer command always replaces the held
+// one, so the last target (e.g. the final OFF of a toggled pump) wins.
+
+class CmdQueue {
+  public:
+    CmdQueue();
+
+    // Network side
+    bool push(const s_command& cmd);
+    void countMalformed();
+
+    // I/O side
+    void collect(); // Drains the fifo into the actuator slots
+    bool pop(s_command& cmd, unsigned long now); // Next pending command allowed by the rate limit
+    bool hasPending(); // In the fifo or in a slot
+
+    // Commands that went through the fifo, each one read by its own side only
+    uint32_t getPushed();    // Network side
+    uint32_t getCollected(); // I/O side
+
+    // Metrics
+    const s_cmdMetrics& getMetrics();
+    uint32_t getRateLimited(int actuatorId);
+
+  private:
+    bool takeToken(int actuatorId, unsigned long now);
+
+  private:
+    SpscQueue<s_command, CMDQUEUE_FIFO_SIZE> fifo;
+
+    // I/O side : last command per actuator
+    s_command pending[CMDQUEUE_MAX_ACTUATORS];
+    bool isPending[CMDQUEUE_MAX_ACTUATORS];
+    bool isHeld[CMDQUEUE_MAX_ACTUATORS]; // already counted as rate limited
+
+    // I/O side : token bucket per actuator, in 1/1000 of command
+    uint32_t credit[CMDQUEUE_MAX_ACTUATORS];
+    unsigned long lastRefill[CMDQUEUE_MAX_ACTUATORS];
+    uint32_t rateLimited[CMDQUEUE_MAX_ACTUATORS];
+
+    uint32_t pushed;    // Network side
+    uint32_t collected; // I/O side
+
+    s_cmdMetrics metrics;
+};
+
+#endif
@@ -7,31 +7,42 @@
 #include <ESP32Servo.h>
 #endif
 
-#include <functional>
-
-#define DEBUG_PRINT_CALLBACK_SIGNATURE std::function<void(String debugPrint)> debugPrintCallback
-#define STATUS_CHANGED_CALLBACK_SIGNATURE std::function<void(int servoId)> statusChangedCallback
-#define POSITION_CHANGED_CALLBACK_SIGNATURE std::function<void(int servoId)> positionChangedCallback
+// Status and debug messages, shared by all sinks
+struct CmdServoBase {
+  enum CmdStatus { OPEN, CLOSED, OPENING, CLOSING };
+  enum CmdDebug { DEBUG_GO_TO_ANGLE, DEBUG_STOP }; // value : angle
+};
 
+////////////////////////////////////////////////////////////////////////
+// Event sink policy
+// CmdServo calls the sink statically, no callback object is stored.
+// A sink provides:
+//   static const bool debug;  // false -> debug messages compiled out
+//   static void statusChanged(int servoId);
+//   static void positionChanged(int servoId);
+//   static void debugPrint(int servoId, CmdServoBase::CmdDebug msg, int value);
+struct NullServoSink {
+  static const bool debug = false;
+  static void statusChanged(int servoId) {}
+  static void positionChanged(int servoId) {}
+  static void debugPrint(int servoId, CmdServoBase::CmdDebug msg, int value) {}
+};
 
-class CmdServo {
+template <class Sink = NullServoSink>
+class CmdServo : public CmdServoBase {
   public:
-    enum CmdStatus { OPEN, CLOSED, OPENING, CLOSING };
-
-    CmdServo(int id, int servoPin, int minPulseValue, int maxPulseValue, int maxDegree, boolean reversed = false, boolean debug = false);
     CmdServo();
     ~CmdServo();
 
-    // Main loop
-    void loop(); // Main loop
+    // Servos are set up in place, never copied (a copy would detach the servo)
+    CmdServo(const CmdServo&) = delete;
+    CmdServo& operator=(const CmdServo&) = delete;
 
-    // Debug
-    void setDebug(bool debug);
+    // Setup
+    void begin(int id, int servoPin, int minPulseValue, int maxPulseValue, int maxDegree, boolean reversed = false);
 
-    // Callbacks
-    void setDebugPrintCallback(DEBUG_PRINT_CALLBACK_SIGNATURE);
-    void setStatusChangedCallback(STATUS_CHANGED_CALLBACK_SIGNATURE);
-    void setPositionChangedCallback(POSITION_CHANGED_CALLBACK_SIGNATURE);
+    // Main loop
+    void loop(); // Main loop
 
   public:
     // Getters
@@ -53,41 +64,228 @@ class CmdServo {
     void goToPosition(int position); // 0-100
 
   private:
-    void init(int id, int servoPin, int minPulseValue, int maxPulseValue, int maxDegree, boolean reversed, boolean debug);
     void attach();
     void detach();
     void goToAngle(int angle); // Goes to specific angle
     int angleToServo(int angle);
-    void debugPrint(String text);
+    void debugPrint(CmdDebug msg, int value);
 
   private:
     Servo servo;
-    boolean attached;
+    boolean attached = false;
 
     int id = 0; // id of the servo
 
     // Previous status
-    CmdStatus previousStatus;
+    CmdStatus previousStatus = CLOSED;
 
     // Position management
     int target = 0;
     int currentPosition = -1; // -1 = unknown value (initial state)
     int previousPosition = -1;
-    
+
     // Servo configuration
-    int servoMinPulse;
-    int servoMaxPulse;
-    int servoPin;
-    int servoMaxDegree;
+    int servoMinPulse = 0;
+    int servoMaxPulse = 0;
+    int servoPin = -1;
+    int servoMaxDegree = 0;
     boolean isReversed = false;
+};
 
-    // Debugging options
-    boolean isDebug = false;
+template <class Sink>
+CmdServo<Sink>::CmdServo() {
 
-    // Callbacks
-    DEBUG_PRINT_CALLBACK_SIGNATURE {nullptr};
-    STATUS_CHANGED_CALLBACK_SIGNATURE { nullptr };
-    POSITION_CHANGED_CALLBACK_SIGNATURE { nullptr };
-};
+}
+
+template <class Sink>
+CmdServo<Sink>::~CmdServo() {
+  if (attached) {
+    servo.detach();
+  }
+}
+
+template <class Sink>
+void CmdServo<Sink>::begin(int id, int servoPin, int minPulseValue, int maxPulseValue, int maxDegree, boolean reversed) {
+  this->id = id;
+  this->servoPin = servoPin;
+  this->servoMinPulse = minPulseValue;
+  this->servoMaxPulse = maxPulseValue;
+  this->servoMaxDegree = maxDegree;
+  this->isReversed = reversed;
+  attached = false;
+}
+
+template <class Sink>
+void CmdServo<Sink>::attach() {
+  servo.attach(servoPin, servoMinPulse, servoMaxPulse);
+  attached = true;
+}
+
+template <class Sink>
+void CmdServo<Sink>::detach() {
+  servo.detach();
+  attached = false;
+}
+
+template <class Sink>
+void CmdServo<Sink>::goToAngle(int angle) {
+  debugPrint(DEBUG_GO_TO_ANGLE, angle);
+
+  // Ensure limits
+  if(angle > servoMaxDegree || angle < 0) {
+    return;
+  }
+
+  if (isMoving()) {
+    setStop(); // Stop
+  }
+
+  target = angle;
+}
+
+
+template <class Sink>
+void CmdServo<Sink>::setStop() {
+  // Cancel current move
+  debugPrint(DEBUG_STOP, currentPosition);
+  target = currentPosition;
+
+  Sink::statusChanged(id);
+}
+
+template <class Sink>
+void CmdServo<Sink>::setOpen() {
+  goToAngle(servoMaxDegree);
+}
+
+template <class Sink>
+void CmdServo<Sink>::setClose() {
+  goToAngle(0);
+}
+
+template <class Sink>
+void CmdServo<Sink>::goToPosition(int position) {
+  if(position >= 0 && position <= 100) {
+    float angle = (float) ((float) position / (float) 100) * (float) servoMaxDegree;
+    int res = (int)round(angle);
+    goToAngle(res);
+  }
+}
+
+template <class Sink>
+void CmdServo<Sink>::loop() {
+  // Do the main loop
+  if (currentPosition != target && attached == false) {
+    attach();
+  }
+
+  // Before move, we take the prev position
+  previousPosition = currentPosition;
+  CmdStatus currentStatus = getStatus();
+
+  if(currentPosition < target){
+    servo.writeMicroseconds(angleToServo(currentPosition++));
+    if (previousStatus != currentStatus) {
+      Sink::statusChanged(id);
+    }
+    Sink::positionChanged(id);
+  }
+  else if(currentPosition > target){
+    servo.writeMicroseconds(angleToServo(currentPosition--));
+    if (previousStatus != currentStatus) {
+      Sink::statusChanged(id);
+    }
+    Sink::positionChanged(id);
+  }
+
+  // Notify that we have reached the target
+  if (currentPosition == target && previousPosition != currentPosition) {
+    detach();
+    Sink::statusChanged(id);
+    Sink::positionChanged(id);
+  }
+
+  previousStatus = currentStatus;
+}
+
+template <class Sink>
+boolean CmdServo<Sink>::isOpening() {
+  return target > currentPosition;
+}
+
+template <class Sink>
+boolean CmdServo<Sink>::isClosing() {
+  return target < currentPosition;
+}
+
+template <class Sink>
+int CmdServo<Sink>::currentAngleInPercent() {
+  return (int)round(((float) currentPosition / (float) servoMaxDegree) * 100);
+}
+
+template <class Sink>
+int CmdServo<Sink>::getId() {
+  return id;
+}
+template <class Sink>
+int CmdServo<Sink>::getPin() {
+  return servoPin;
+}
+template <class Sink>
+int CmdServo<Sink>::getAngle() {
+  return currentPosition;
+}
+
+template <class Sink>
+boolean CmdServo<Sink>::isClosed() {
+  return currentPosition == 0;
+}
+
+template <class Sink>
+boolean CmdServo<Sink>::isMoving() {
+  return currentPosition != target;
+}
+
+template <class Sink>
+typename CmdServo<Sink>::CmdStatus CmdServo<Sink>::getStatus() {
+  if (currentPosition == 0) {
+    return CLOSED;
+  } else if(target < currentPosition) {
+    return CLOSING;
+  } else if(target > currentPosition) {
+    return OPENING;
+  }
+
+  return OPEN;
+}
+
+// Privates
+template <class Sink>
+void CmdServo<Sink>::debugPrint(CmdDebug msg, int value) {
+  if (Sink::debug) { // Compile-time, nothing is left when the sink has no debug
+    Sink::debugPrint(id, msg, value);
+  }
+}
+
+template <class Sink>
+int CmdServo<Sink>::angleToServo(int angle){
+  // Convert from min - max to 0 - 270
+
+  // formula: (degree * (max - min / servoMax)) + offset
+  float result = (angle * (float)((float)(servoMaxPulse - servoMinPulse) / (float)servoMaxDegree)) + servoMinPulse;
+
+  int res = (int)round(result);
+
+  if(isReversed) { // Servo reversing support
+    res = (servoMaxPulse + servoMinPulse) - res;
+  }
+
+  // Ensure result is valid
+  if (res < servoMinPulse || res > servoMaxPulse) {
+    return servoMinPulse;
+  }
+
+  return res;
+}
 
 #endif
@@ -0,0 +1,108 @@
+#include "DebugLog.h"
+
+static const char* const logFormats[] = { LOG_FORMATS(LOG_FORMAT_TEXT) };
+static const char logLevels[] = { 'E', 'W', 'I', 'D' };
+
+DebugLog::DebugLog() {
+  currentLevel = lINFO;
+  unsent = 0;
+
+  for (int r = 0; r < LOG_RINGS; r++) {
+    suppressed[r] = 0;
+    for (int f = 0; f < LOG_FORMAT_COUNT; f++) {
+      windowStart[r][f] = 0;
+      windowCount[r][f] = 0;
+    }
+  }
+}
+
+void DebugLog::setLevel(e_logLevel level) {
+  currentLevel = level;
+}
+
+e_logLevel DebugLog::getLevel() {
+  return currentLevel;
+}
+
+size_t DebugLog::getPending() {
+  size_t pending = 0;
+  for (int r = 0; r < LOG_RINGS; r++) {
+    pending += ring[r].size();
+  }
+  return pending;
+}
+
+int DebugLog::popBatch(s_logBatch& batch) {
+  int count = 0;
+  for (int r = 0; r < LOG_RINGS; r++) {
+    while (count < LOG_BATCH && ring[r].pop(batch.Records[count])) {
+      count++;
+    }
+  }
+
+  batch.Version = LOG_VERSION;
+  batch.Count = count;
+  batch.Reserved = 0;
+  batch.Dropped = getDropped();
+  batch.Suppressed = getSuppressed();
+  return count;
+}
+
+int DebugLog::format(const s_logRecord& rec, char* buffer, size_t length) {
+  const char* text = rec.Format < LOG_FORMAT_COUNT ? logFormats[rec.Format] : "Unknown format %d %d";
+  char level = rec.Level < sizeof(logLevels) ? logLevels[rec.Level] : '?';
+
+  int n = snprintf(buffer, length, "%lu %c ", (unsigned long)rec.Time, level);
+  if (n < 0 || (size_t)n >= length) {
+    return n;
+  }
+  return n + snprintf(buffer + n, length - n, text, (int)rec.Args[0], (int)rec.Args[1]);
+}
+
+void DebugLog::countUnsent(int count) {
+  unsent += count;
+}
+
+uint32_t DebugLog::getDropped() {
+  uint32_t dropped = unsent;
+  for (int r = 0; r < LOG_RINGS; r++) {
+    dropped += ring[r].getDropped();
+  }
+  return dropped;
+}
+
+uint32_t DebugLog::getSuppressed() {
+  uint32_t total = 0;
+  for (int r = 0; r < LOG_RINGS; r++) {
+    total += suppressed[r];
+  }
+  return total;
+}
+
+// Privates
+void DebugLog::record(e_logLevel level, e_logFormat format, int32_t arg0, int32_t arg1) {
+  int r = ringIndex();
+  uint32_t now = millis();
+
+  // Per format rate limit
+  if (now - windowStart[r][format] >= LOG_SITE_WINDOW) {
+    windowStart[r][format] = now;
+    windowCount[r][format] = 0;
+  }
+  if (windowCount[r][format] >= LOG_SITE_BURST) {
+    suppressed[r]++;
+    return;
+  }
+  windowCount[r][format]++;
+
+  s_logRecord rec = { now, (uint8_t)format, (uint8_t)level, (uint8_t)r, 0, { arg0, arg1 } };
+  ring[r].push(rec);
+}
+
+int DebugLog::ringIndex() {
+#if defined(ESP32)
+  return xPortGetCoreID();
+#else
+  return 0;
+#endif
+}
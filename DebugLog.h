@@ -0,0 +1,104 @@
+#ifndef DEBUGLOG_H
+#define DEBUGLOG_H
+
+#include "Arduino.h"
+#include "SpscQueue.h"
+#include "LogFormats.h"
+
+#ifndef LOG_LEVEL_MAX
+#define LOG_LEVEL_MAX lDEBUG // calls above this level are compiled out
+#endif
+#ifndef LOG_RING_SIZE
+#define LOG_RING_SIZE 64 // records per ring, power of two
+#endif
+#ifndef LOG_BATCH
+#define LOG_BATCH 8 // records per MQTT message (PubSubClient packets are 256 bytes)
+#endif
+#ifndef LOG_SITE_BURST
+#define LOG_SITE_BURST 10 // records per format ...
+#endif
+#ifndef LOG_SITE_WINDOW
+#define LOG_SITE_WINDOW 1000 // ... per this many milliseconds
+#endif
+
+// One ring per core, each one written by a single task
+#if defined(ESP32)
+#define LOG_RINGS 2
+#else
+#define LOG_RINGS 1
+#endif
+
+#define LOG_VERSION 1
+
+enum e_logLevel { lERROR, lWARN, lINFO, lDEBUG };
+
+// Binary record, 16 bytes, little endian on the wire
+struct s_logRecord {
+  uint32_t Time;   // millis()
+  uint8_t Format;  // e_logFormat
+  uint8_t Level;   // e_logLevel
+  uint8_t Ring;    // core
+  uint8_t Reserved;
+  int32_t Args[2];
+};
+
+// MQTT message : header then Count records
+struct s_logBatch {
+  uint8_t Version;
+  uint8_t Count;
+  uint16_t Reserved;
+  uint32_t Dropped;    // total, rings full or batches not published
+  uint32_t Suppressed; // total, rate limited
+  s_logRecord Records[LOG_BATCH];
+};
+
+static_assert(sizeof(s_logRecord) == 16, "s_logRecord is a wire format");
+static_assert(sizeof(s_logBatch) == 12 + 16 * LOG_BATCH, "s_logBatch is a wire format");
+
+////////////////////////////////////////////////////////////////////////
+// Deferred binary log
+// write() only stores a format id and two integers in a RAM ring, the
+// text is built when the network side drains the rings (popBatch/format).
+
+class DebugLog {
+  public:
+    DebugLog();
+
+    // Any task (one task per core)
+    void write(e_logLevel level, e_logFormat format, int32_t arg0 = 0, int32_t arg1 = 0) {
+      if (level > LOG_LEVEL_MAX || level > currentLevel) {
+        return;
+      }
+      record(level, format, arg0, arg1);
+    }
+
+    void setLevel(e_logLevel level);
+    e_logLevel getLevel();
+
+    // Network side
+    size_t getPending();
+    int popBatch(s_logBatch& batch); // Returns the number of records
+    int format(const s_logRecord& rec, char* buffer, size_t length); // Text as on serial
+    void countUnsent(int count); // Popped records that did not reach the debug topic
+
+    uint32_t getDropped(); // Rings full + unsent
+    uint32_t getSuppressed();
+
+  private:
+    void record(e_logLevel level, e_logFormat format, int32_t arg0, int32_t arg1);
+    int ringIndex();
+
+  private:
+    SpscQueue<s_logRecord, LOG_RING_SIZE> ring[LOG_RINGS];
+
+    // Per format rate limit, per ring (written by the ring producer)
+    uint32_t windowStart[LOG_RINGS][LOG_FORMAT_COUNT];
+    uint16_t windowCount[LOG_RINGS][LOG_FORMAT_COUNT];
+    uint32_t suppressed[LOG_RINGS];
+
+    uint32_t unsent; // Network side
+
+    volatile e_logLevel currentLevel;
+};
+
+#endif
@@ -1,12 +1,17 @@
 
+// Board profile, can also be given on the command line (see tools/footprint.sh)
+#if !defined(__VMC1LR__) && !defined(__ARROSLR__)
 //#define __VMC1LR__
 #define __ARROSLR__
+#endif
 
 #define SW_VERSION "0.1"
 
 enum e_actuator { tSERVO, tDIGOUT, tDIGTEMP};
 enum e_sensor { tDIGIN, tANIN, tTIC};
 
+#include "Snapshot.h" // snapshot record, I/O -> network
+
 ////////////////////////////////////////////////////////////////////////
 // Compilation for VMC - ESP8266
 #ifdef __VMC1LR__
@@ -15,7 +20,7 @@ enum e_sensor { tDIGIN, tANIN, tTIC};
 #define CLID "vmc1"
 
 const struct s_actuator {
-  char Name[13];
+  char name[13];
   e_actuator Type;
   int Pin;
   boolean reversed;
@@ -30,7 +35,7 @@ const struct s_actuator {
 
 
 const struct s_sensor {
-  char Name[13];
+  char name[13];
   e_sensor Type;
   int Pin;
 } sensor[1] = {{"powerstatus", tDIGIN, D9}};
@@ -60,6 +65,10 @@ const struct s_sensor {
   int Pin;
 } sensor[1] = {{"soil", tANIN, 36}};
 
+// Battery/solar : sleep between sensor samples (see PowerManager.h)
+#define POWER_MANAGED
+#define SENSOR_TIME 600000
+
 #endif // __ARROSLR__
 
 
@@ -79,6 +88,25 @@ const char* ota_password = "BlindsOTA";
 //const unsigned int servoPins[] = { D7, D6, D5, D4, D3, D2, D1 };
 //const unsigned int reversedPins[] = { }; // Array of reversed servo pins. Must be subset of servoPins.
 const unsigned int turnTime = 50; // how many milliseconds after one point of turn (must be greater than amount of turn time of all the servos)
+#ifndef SENSOR_TIME
+#define SENSOR_TIME 10000
+#endif
+const unsigned long sensorTime = SENSOR_TIME; // how many milliseconds between two sensor samples
+const unsigned int awakeTime = 3000; // how many milliseconds a wake-up stays awake for MQTT exchange (POWER_MANAGED only)
+const unsigned int metricsTime = 60000; // how many milliseconds between two metrics publications
+const unsigned int logTime = 1000; // how many milliseconds at most before the debug log is flushed
+
+////////////////////////////////////////////////////////////////////////
+// Tasks settings
+// ESP32 : network/MQTT/OTA task on core 0, actuators/sensors task on core 1
+// ESP8266 : both run one after the other in loop()
+#define TLM_QUEUE_SIZE 32 // I/O -> network, power of two
+#define NET_TASK_CORE 0
+#define NET_TASK_STACK 8192
+#define NET_TASK_PRIORITY 1
+#define IO_TASK_CORE 1
+#define IO_TASK_STACK 4096
+#define IO_TASK_PRIORITY 2
 
 
 ////////////////////////////////////////////////////////////////////////
@@ -94,6 +122,13 @@ const char* client_type = CLTYPE; // Must be unique on the MQTT network
 const char* client_id = CLID; // Must be unique on the MQTT network
 const boolean retain_status = true; // Retain status messages (keeps blinds status available after HA reset)
 const boolean retain_position = true; // Retain position messages
+#if defined(POWER_MANAGED)
+const boolean clean_session = false; // Keep the session while sleeping : QoS1 commands wait on the broker
+const uint8_t command_qos = 1; // Subscription QoS of the command topics
+#else
+const boolean clean_session = true;
+const uint8_t command_qos = 0;
+#endif
 
 ////////////////////////////////////////////////////////////////////////
 // Home assistant configuration
@@ -108,9 +143,12 @@ const int servo_max_angle = 270;
 
 ////////////////////////////////////////////////////////////////////////
 // Mqtt topics (for advanced use, no need to modify)
-const char* mqtt_state_topic        = CLTYPE "/" CLID "/%s/state";
-const char* mqtt_command_topic      = CLTYPE "/" CLID "/%s/set";
-const char* mqtt_position_topic     = CLTYPE "/" CLID "/%s/position";
-const char* mqtt_set_position_topic = CLTYPE "/" CLID "/%s/position/set";
-const char* mqtt_debug_topic        = CLTYPE "/" CLID "/%s/debug"; // debug topic
-const char* ha_config_topic           = "homeassistant/cover/" CLTYPE "/" CLID "/%s/config";
+const char* mqtt_state_topic        = CLTYPE "/" CLID "/%d/state";
+const char* mqtt_command_topic      = CLTYPE "/" CLID "/%d/set";
+const char* mqtt_position_topic     = CLTYPE "/" CLID "/%d/position";
+const char* mqtt_set_position_topic = CLTYPE "/" CLID "/%d/position/set";
+const char* mqtt_debug_topic        = CLTYPE "/" CLID "/%s/debug"; // debug topic, binary s_logBatch (tools/logdecode.py)
+const char* mqtt_sensor_topic       = CLTYPE "/" CLID "/%s/value"; // sensor value, by sensor name
+const char* mqtt_metrics_topic      = CLTYPE "/" CLID "/metrics"; // command queue counters
+const char* mqtt_power_topic        = CLTYPE "/" CLID "/power"; // power counters (POWER_MANAGED)
+const char* ha_config_topic           = "homeassistant/cover/" CLTYPE "/" CLID "/%d/config";
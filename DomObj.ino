@@ -35,15 +35,51 @@
 
 #include "DomObj.h"
 #include "CmdServo.h"
+#include "SpscQueue.h"
+#include "CmdQueue.h"
+#include "DebugLog.h"
+#include "PowerManager.h"
+
+// Pinned tasks on ESP32, the network task also decides when to sleep (POWER_MANAGED)
+#if defined(ESP32)
+#define DOMOBJ_TASKS
+#endif
+
+#if defined(POWER_MANAGED)
+#if !defined(ESP32)
+#error "POWER_MANAGED needs an ESP32 (light/deep sleep)"
+#endif
+#include <atomic>
+#include <esp_sleep.h>
+#include <sys/time.h>
+#endif
 
 
 #define JSON_BUFFER_LENGTH 2048
 #define MQTT_TOPIC_MAX_LENGTH 256
+#define WIFI_RESUME_TIMEOUT 10000 // ms to get the WiFi back before giving up until the next try
+#define MQTT_BUFFER_SIZE 512 // PubSubClient default is 256 : too short for the metrics
 
 #define DEBUG true // default value for debug
 
 // Callbacks
 void mqttCallback(char* topic, byte* payload, unsigned int payloadLength);
+void statusChanged(int servoId);
+void positionChanged(int servoId);
+
+// Debug log, drained by the network side (flushLog)
+DebugLog debugLog;
+
+// CmdServo events, dispatched at compile time
+struct DomObjServoSink {
+  static const bool debug = DEBUG; // false -> servo debug messages are compiled out
+  static void statusChanged(int servoId) { ::statusChanged(servoId); }
+  static void positionChanged(int servoId) { ::positionChanged(servoId); }
+  static void debugPrint(int servoId, CmdServoBase::CmdDebug msg, int value) {
+    debugLog.write(lDEBUG, msg == CmdServoBase::DEBUG_STOP ? fSERVO_STOP : fSERVO_GO_TO_ANGLE, servoId, value);
+  }
+};
+typedef CmdServo<DomObjServoSink> DomServo;
 
 // Wifi
 WiFiClient wifiClient;
@@ -54,7 +90,38 @@ PubSubClient client(mqtt_server, mqtt_port, mqttCallback, wifiClient);
 int numberOfActuators = 0;
 int numberOfSensors = 0;
 
-CmdServo servos[sizeof(s_actuator)];
+DomServo servos[sizeof(actuator) / sizeof(actuator[0])]; // set up in place by begin()
+
+// Queues between network side and I/O side
+CmdQueue cmdQueue;                              // mqttCallback -> applyCommand
+SpscQueue<s_snapshot, TLM_QUEUE_SIZE> tlmQueue; // statusChanged/sampleSensors -> publishSnapshot
+
+#if defined(DOMOBJ_TASKS)
+TaskHandle_t netTaskHandle = NULL;
+TaskHandle_t ioTaskHandle = NULL;
+#endif
+
+#if defined(POWER_MANAGED)
+#define RTC_MAGIC 0x446F6D31 // "Dom1"
+
+// Runtime state kept in RTC memory across deep sleep
+struct s_rtcState {
+  uint32_t Magic;
+  uint32_t UptimeOffset;   // ms slept in deep sleep + ms awake before, added to millis()
+  uint32_t SleepStart;     // uptime() when the deep sleep started
+  uint32_t SleepRequested; // ms
+  int64_t SleepStartUs;    // RTC time when the deep sleep started, it keeps running while asleep
+  s_powerState Power;
+};
+RTC_DATA_ATTR s_rtcState rtcState;
+
+PowerManager powerManager;
+volatile uint32_t outputsOn = 0; // digital outputs set HIGH, by actuator index (modem sleep only then), I/O task -> powerStep
+
+// I/O side state for powerStep : (commands collected << 1) | idle, stored
+// by ioStep() once the collected commands are applied and the servos stopped
+std::atomic<uint32_t> ioIdleMark(0);
+#endif
 
 // debug
 bool debug = DEBUG;
@@ -64,6 +131,9 @@ int pos = 0;
 //String uniqueId;
 
 unsigned long loopStart;
+volatile unsigned long sensorStart; // I/O task -> powerStep
+unsigned long metricsStart;
+unsigned long logStart;
 
 ////////////////////////////////////////////////////////////////////////
 // Setup
@@ -77,6 +147,23 @@ void setup() {
 
   Serial.println("DomObj v" SW_VERSION);
 
+  debugLog.setLevel(debug ? lDEBUG : lINFO);
+
+#if defined(POWER_MANAGED)
+  // Restore runtime state after a deep sleep, reset it otherwise
+  if (esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_TIMER && rtcState.Magic == RTC_MAGIC) {
+    // Back from deep sleep : measure the real sleep (boot included) on the RTC clock
+    unsigned long slept = (unsigned long)((rtcTimeUs() - rtcState.SleepStartUs) / 1000);
+    powerManager.restore(rtcState.Power);
+    powerManager.wokeUp(pDEEP_SLEEP, rtcState.SleepRequested, slept);
+    rtcState.UptimeOffset = rtcState.SleepStart + slept - millis();
+  } else {
+    memset(&rtcState, 0, sizeof(rtcState));
+    rtcState.Magic = RTC_MAGIC;
+  }
+  powerManager.begin(uptime(), awakeTime);
+#endif
+
   wifiConnect();
 
   // Setup OTA
@@ -101,10 +188,7 @@ void setup() {
   for (int i = 0; i < numberOfActuators; i++) {
 	  
 	if (actuator[i].Type == tSERVO) {
-       servos[numberOfServos] = CmdServo(i+1, actuator[i].Pin, servo_min_pulse, servo_max_pulse, servo_max_angle, actuator[i].reversed, debug);
-       servos[numberOfServos].setDebugPrintCallback(debugPrint);
-       servos[numberOfServos].setStatusChangedCallback(statusChanged);
-       servos[numberOfServos].setPositionChangedCallback(positionChanged);
+       servos[numberOfServos].begin(i+1, actuator[i].Pin, servo_min_pulse, servo_max_pulse, servo_max_angle, actuator[i].reversed);
 	   numberOfServos++;
 	   }
 
@@ -126,9 +210,44 @@ void setup() {
 
 ////////////////
 
+  client.setBufferSize(MQTT_BUFFER_SIZE);
   mqttConnect();
   client.setCallback(mqttCallback);
 
+#if defined(POWER_MANAGED)
+  WiFi.setSleep(true); // modem sleep between beacons when idle
+
+  // First window : sample now, then exchange over MQTT
+  sensorStart = uptime() - sensorTime;
+  powerManager.openWindow(uptime());
+#endif
+
+#if defined(DOMOBJ_TASKS)
+  // Network on core 0, actuators and sensors on core 1
+  xTaskCreatePinnedToCore(netTask, "net", NET_TASK_STACK, NULL, NET_TASK_PRIORITY, &netTaskHandle, NET_TASK_CORE);
+  xTaskCreatePinnedToCore(ioTask, "io", IO_TASK_STACK, NULL, IO_TASK_PRIORITY, &ioTaskHandle, IO_TASK_CORE);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////
+// Wifi - reconnect with the credentials saved by WiFiManager
+boolean wifiResume() {
+  if (WiFi.status() == WL_CONNECTED) {
+    return true;
+  }
+
+  WiFi.mode(WIFI_STA);
+  WiFi.begin();
+  unsigned long start = millis();
+  while (WiFi.status() != WL_CONNECTED && millis() - start < WIFI_RESUME_TIMEOUT) {
+    delay(100);
+  }
+
+  if (WiFi.status() != WL_CONNECTED) {
+    debugLog.write(lWARN, fWIFI_RESUME_FAILED, WIFI_RESUME_TIMEOUT, WiFi.status());
+    return false;
+  }
+  return true;
 }
 
 void wifiConnect() {
@@ -195,7 +314,7 @@ void mqttConnect() {
   if (!!!client.connected()) {
     Serial.println("Try to connect mqtt..");
     int count = 20;
-    while (count-- > 0 && !!!client.connect(client_id, mqtt_username, mqtt_password)) {
+    while (count-- > 0 && !!!client.connect(client_id, mqtt_username, mqtt_password, 0, 0, false, 0, clean_session)) {
       delay(500);
     }
 
@@ -217,33 +336,208 @@ void initOTA() {
 ////////////////////////////////////////////////////////////////////////
 void loop()
 {
+#if defined(DOMOBJ_TASKS)
+  // Everything runs in netTask and ioTask
+  vTaskDelete(NULL);
+#else
+  // Cooperative fallback, same queues
+  netStep();
+  ioStep();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////
+// Time in ms, keeps counting across deep sleep when POWER_MANAGED
+unsigned long uptime() {
+#if defined(POWER_MANAGED)
+  return rtcState.UptimeOffset + millis();
+#else
+  return millis();
+#endif
+}
+
+#if defined(POWER_MANAGED)
+////////////////////////////////////////////////////////////////////////
+// RTC time in us, kept across deep sleep (unlike millis())
+int64_t rtcTimeUs() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////
+// Network side : MQTT, OTA, mDNS
+void netStep() {
   // check that we are connected
   if (!client.loop()) {
-    mqttConnect();
+    debugLog.write(lWARN, fMQTT_RECONNECT, client.state());
+    if (wifiResume()) {
+      mqttConnect();
+    }
+  }
+
+  // Publish what the I/O side reported
+  s_snapshot snap;
+  while (tlmQueue.pop(snap)) {
+    publishSnapshot(snap);
+  }
+
+  unsigned long now = uptime();
+
+  if(now - metricsStart >= metricsTime) {
+    metricsStart = now;
+    publishMetrics();
+#if defined(POWER_MANAGED)
+    publishPower();
+#endif
+  }
+
+  // Flush the debug log by batches, or when it has waited long enough
+  if(debugLog.getPending() >= LOG_BATCH || (now - logStart >= logTime && debugLog.getPending() > 0)) {
+    logStart = now;
+    flushLog();
   }
 
-  unsigned long now = millis();
+  // Rest of the loop
+#if defined(ESP8266)
+  MDNS.update();
+#endif
+  ArduinoOTA.handle();
+}
+
+////////////////////////////////////////////////////////////////////////
+// I/O side : actuators, sensors
+void ioStep() {
+  // Collect commands received by the network side (last one wins per actuator)
+  cmdQueue.collect();
+
+  unsigned long now = uptime();
 
   if(now - loopStart >= turnTime) {
-    // Over one sec from start loop passed
     loopStart = now;
 
-////////////////
+    // Apply commands at tick time
+    s_command cmd;
+    while (cmdQueue.pop(cmd, now)) {
+      applyCommand(cmd);
+    }
+
     // Main servo loop
     for (int i = 0; i < numberOfServos; i++) {
       servos[i].loop();
     }
-////////////////
+  }
 
+  if(now - sensorStart >= sensorTime) {
+    sensorStart = now;
+    sampleSensors();
   }
 
-  // Rest of the loop
-#if defined(ESP8266)
-  MDNS.update();
+#if defined(POWER_MANAGED)
+  // Idle mark for powerStep(), once outputsOn and the servo targets are set
+  boolean idle = !cmdQueue.hasPending();
+  for (int i = 0; i < numberOfServos; i++) {
+    if (servos[i].isMoving()) {
+      idle = false;
+    }
+  }
+  ioIdleMark.store((cmdQueue.getCollected() << 1) | (idle ? 1 : 0), std::memory_order_release);
 #endif
-  ArduinoOTA.handle();
 }
 
+#if defined(DOMOBJ_TASKS)
+void netTask(void* param) {
+  for (;;) {
+    netStep();
+#if defined(POWER_MANAGED)
+    powerStep(); // light and deep sleep stop both cores, only once the I/O side is idle
+#endif
+    vTaskDelay(1);
+  }
+}
+
+void ioTask(void* param) {
+  for (;;) {
+    ioStep();
+    vTaskDelay(1);
+  }
+}
+#endif
+
+#if defined(POWER_MANAGED)
+////////////////////////////////////////////////////////////////////////
+// Power : sleep until the next sensor sample once the wake-up window is over
+// Runs in the network task : the inputs are read in this order on purpose
+void powerStep() {
+  // 1. I/O side idle : every command pushed so far was collected and applied
+  uint32_t mark = ioIdleMark.load(std::memory_order_acquire);
+  boolean ioIdle = (mark & 1) && (mark >> 1) == (cmdQueue.getPushed() & 0x7FFFFFFF);
+
+  // 2. Outputs, as set by those commands. One ON : stay reachable for its OFF
+  //    command (short modem sleeps), deep sleep would also reset the pin
+  boolean linkRequired = outputsOn != 0;
+  boolean deepAllowed = numberOfServos == 0 && !linkRequired; // deep sleep forgets servo positions
+
+  // 3. Network side work
+  boolean busy = !ioIdle || !tlmQueue.isEmpty() || debugLog.getPending() > 0;
+
+  unsigned long now = uptime();
+  unsigned long duration;
+  e_powerMode mode = powerManager.step(now, sensorStart + sensorTime, busy, deepAllowed, linkRequired, duration);
+  if (mode == pBUSY) {
+    return;
+  }
+
+  switch(mode) {
+    case pMODEM_SLEEP:
+      delay(duration); // CPU idles, WiFi modem sleeps between beacons
+      break;
+    case pLIGHT_SLEEP:
+      linkSuspend(); // WiFi does not survive an explicit light sleep
+      esp_sleep_enable_timer_wakeup((uint64_t)duration * 1000);
+      esp_light_sleep_start(); // millis() keeps counting
+      break;
+    case pDEEP_SLEEP:
+      // Nothing survives but rtcState : setup() measures the sleep at wake-up
+      rtcState.Power = powerManager.getState();
+      rtcState.SleepStart = now;
+      rtcState.SleepRequested = duration;
+      rtcState.SleepStartUs = rtcTimeUs();
+      Serial.flush();
+      esp_deep_sleep((uint64_t)duration * 1000);
+      break;
+    default:
+      break;
+  }
+
+  unsigned long after = uptime();
+  powerManager.resume(mode, duration, after - now, after);
+
+  if (mode == pLIGHT_SLEEP) {
+    linkResume(); // WiFi, then MQTT
+    powerManager.openWindow(uptime()); // the window starts once connected
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// Link : stop WiFi before an explicit light sleep
+void linkSuspend() {
+  client.disconnect();
+  WiFi.disconnect(true); // WiFi off, credentials kept
+}
+
+////////////////////////////////////////////////////////////////////////
+// Link : WiFi with the saved credentials, then MQTT
+void linkResume() {
+  if (!wifiResume()) {
+    return; // netStep() tries again
+  }
+  WiFi.setSleep(true);
+  mqttConnect();
+}
+#endif
+
 
 
 ////////////////////////////////////////////////////////////////////////
@@ -263,24 +557,35 @@ String getParam(WiFiManager wm, String name){
 
 ////////////////////////////////////////////////////////////////////////
 // CmdServo - get a servo by its id
-CmdServo& servoById(int id) {
+DomServo* servoById(int id) {
   for (int i = 0; i < numberOfServos; i++) {
-    CmdServo& s = servos[i];
-    if (s.getId() == id) {
-      return s;
+    if (servos[i].getId() == id) {
+      return &servos[i];
     }
   }
+  return NULL;
 }
 
 ////////////////////////////////////////////////////////////////////////
 // CmdServo - get a servo by its pin number
-CmdServo& servoByPin(int pin) {
+DomServo* servoByPin(int pin) {
   for (int i = 0; i < numberOfServos; i++) {
-    CmdServo& s = servos[i];
-    if (s.getPin() == pin) {
-      return s;
+    if (servos[i].getPin() == pin) {
+      return &servos[i];
     }
   }
+  return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////
+// Actuators - get an actuator index by its type and pin number, -1 if none
+int actuatorByPin(e_actuator type, int pin) {
+  for (int i = 0; i < numberOfActuators; i++) {
+    if (actuator[i].Type == type && actuator[i].Pin == pin) {
+      return i;
+    }
+  }
+  return -1;
 }
 
 String getValue(String data, char separator, int index)
@@ -303,12 +608,14 @@ String getValue(String data, char separator, int index)
 ////////////////////////////////////////////////////////////////////////
 // MQTT - publish an actuator config (SERVO, DIGITAL)
 void subscribeAndPublishConfig(int ActuatorId) {
-   CmdServo s;
-
    if (actuator[ActuatorId].Type == tSERVO) {
-      s = servoByPin(actuator[ActuatorId].Pin);
+      DomServo* s = servoByPin(actuator[ActuatorId].Pin);
+      if (s == NULL) {
+         Serial.print("Failed to publish ha config, no servo (" + String(ActuatorId) + ")");
+         return;
+         }
       Serial.print("Publishing ha config for servo ");
-      Serial.println(String(s.getId()));
+      Serial.println(String(s->getId()));
       }
    else if ((actuator[ActuatorId].Type == tDIGOUT)||(actuator[ActuatorId].Type == tDIGTEMP)) {
       //actuator[ActuatorId].Pin;
@@ -324,27 +631,27 @@ void subscribeAndPublishConfig(int ActuatorId) {
 
    // Subscribe to the set actuator topic
    char topic[MQTT_TOPIC_MAX_LENGTH];
-   sprintf(topic, mqtt_command_topic, String(ActuatorId));
+   sprintf(topic, mqtt_command_topic, ActuatorId);
 
-   if (client.subscribe(topic)) {
+   if (client.subscribe(topic, command_qos)) {
       // OK
-      debugPrint("Subscribed to " CLTYPE " set topic (" + String(ActuatorId) + "), uniqueId = " CLID);
+      debugLog.write(lDEBUG, fSUBSCRIBED_SET, ActuatorId);
    } else {
       // FAIL
-      debugPrint("Failed to subscribe to " CLTYPE " set topic (" + String(ActuatorId) + ")");
+      debugLog.write(lWARN, fSUBSCRIBE_SET_FAILED, ActuatorId);
    }
 
    // Subscribe to the set position actuator topic -- only for servos actuators --
    if (actuator[ActuatorId].Type == tSERVO) {
       char set_position_t[MQTT_TOPIC_MAX_LENGTH];
-      sprintf(set_position_t, mqtt_set_position_topic, s.getId());
-      if (client.subscribe(set_position_t)) {
+      sprintf(set_position_t, mqtt_set_position_topic, ActuatorId);
+      if (client.subscribe(set_position_t, command_qos)) {
          // OK
-         debugPrint("Subscribed to blinds set position topic (" + String(s.getId()) + "), uniqueId = " CLID);
+         debugLog.write(lDEBUG, fSUBSCRIBED_POSITION, ActuatorId);
          publishConfig(ActuatorId); // Publish config right after subscribed to command topic
       } else {
          // FAIL
-         debugPrint("Failed to subscribe to blinds set topic (" + String(s.getId()) + ")");
+         debugLog.write(lWARN, fSUBSCRIBE_POSITION_FAILED, ActuatorId);
       }
    }
 
@@ -352,25 +659,27 @@ void subscribeAndPublishConfig(int ActuatorId) {
    }
 
 ////////////////////////////////////////////////////////////////////////
-// MQTT - get a topic
+// MQTT - get a topic -> parse and queue the command, applied by ioStep()
 void mqttCallback(char* topic, byte * payload, unsigned int length) {
-  Serial.print("Got MQTT callback! ");
-  Serial.print("topic = ");
-  Serial.println(topic);
-  
-  String myString = String(topic);
-
   String v = getValue(topic, '/', 2); // Get the second value
   if (!v.length()) {
+    debugLog.write(lDEBUG, fMQTT_MALFORMED, -1, length);
+    cmdQueue.countMalformed();
     return;
   }
   
   int ActuatorId = v.toInt(); // Get actuator id
   
-  if (ActuatorId>numberOfActuators) { // Wrong id
+  if (ActuatorId < 0 || ActuatorId >= numberOfActuators) { // Wrong id
+    debugLog.write(lDEBUG, fMQTT_MALFORMED, ActuatorId, length);
+    cmdQueue.countMalformed();
     return;
   }
+
+  debugLog.write(lDEBUG, fMQTT_RECEIVED, ActuatorId, length);
   
+  s_command cmd = { (uint8_t)ActuatorId, cSTOP, 0 };
+  boolean parsed = false;
 
   // Check
   if (getValue(topic, '/', 0) == client_type) { //Ensure correct client topic
@@ -378,63 +687,150 @@ void mqttCallback(char* topic, byte * payload, unsigned int length) {
        String thirdValue = getValue(topic, '/', 3);
        if(thirdValue == "set") { // Ensure set topic
          if (actuator[ActuatorId].Type==tSERVO)
-           handleSetServo(payload, length, ActuatorId);
+           parsed = parseSetServo(payload, length, cmd);
          else if (actuator[ActuatorId].Type==tDIGOUT)
-           handleSetDigout(payload, length, ActuatorId);
+           parsed = parseSetDigout(payload, length, cmd);
          else if (actuator[ActuatorId].Type==tDIGTEMP)
-           handleSetDigtemp(payload, length, ActuatorId);
+           parsed = parseSetDigtemp(payload, length, cmd);
        } else if(thirdValue == "position") {
           String fourthValue = getValue(topic, '/', 4);
-          if(fourthValue == "set") { // Ensure set topic
-            handleSetPosition(payload, length, ActuatorId);
+          if(fourthValue == "set" && actuator[ActuatorId].Type==tSERVO) { // Ensure set topic
+            parsed = parseSetPosition(payload, length, cmd);
           }
        }
      }
   }
+
+  if (parsed) {
+    cmdQueue.push(cmd);
+  } else {
+    debugLog.write(lDEBUG, fMQTT_MALFORMED, ActuatorId, length);
+    cmdQueue.countMalformed();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// subMQTT - payload equals keyword (payload is not NUL-terminated)
+boolean payloadIs(const byte * payload, unsigned int length, const char* keyword) {
+  return length == strlen(keyword) && !memcmp(payload, keyword, length);
+}
+
+////////////////////////////////////////////////////////////////////////
+// subMQTT - Parse a servo state
+boolean parseSetServo(const byte * payload, unsigned int length, s_command& cmd) {
+  if (payloadIs(payload, length, "OPEN")) {
+    cmd.Cmd = cOPEN;
+  } else if (payloadIs(payload, length, "CLOSE")) {
+    cmd.Cmd = cCLOSE;
+  } else if (payloadIs(payload, length, "STOP")) { 
+    cmd.Cmd = cSTOP;
+  } else {
+    return false;
+  }
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////
-// subMQTT - Set a servo state
-void handleSetServo(byte * payload, unsigned int length, int ActuatorId) {
-  CmdServo& s = servoByPin(actuator[ActuatorId].Pin);
-  if (!strncmp((char *)payload, "OPEN", length)) {
-    s.setOpen();
-  } else if (!strncmp((char *)payload, "CLOSE", length)) {
-    s.setClose();
-  } else if (!strncmp((char *)payload, "STOP", length)) { 
-    s.setStop();
+// subMQTT - Parse a digital pin
+boolean parseSetDigout(const byte * payload, unsigned int length, s_command& cmd) {
+  if (payloadIs(payload, length, "ON")) {
+    cmd.Cmd = cON;
+  } else if (payloadIs(payload, length, "OFF")) {
+    cmd.Cmd = cOFF;
+  } else {
+    return false;
   }
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////
-// subMQTT - Set a digital pin
-void handleSetDigout(byte * payload, unsigned int length, int ActuatorId) {
-  if (!strncmp((char *)payload, "ON", length)) {
-    digitalWrite(actuator[ActuatorId].Pin, HIGH);
-  } else if (!strncmp((char *)payload, "OFF", length)) {
-    digitalWrite(actuator[ActuatorId].Pin, LOW);
+// subMQTT - Parse a digital pin with tempo
+boolean parseSetDigtemp(const byte * payload, unsigned int length, s_command& cmd) {
+  if (payloadIs(payload, length, "ON")) {
+    cmd.Cmd = cON;
+  } else if (payloadIs(payload, length, "OFF")) { 
+    cmd.Cmd = cOFF;
+  } else {
+    return false;
   }
+  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////
-// subMQTT - Set a digital pin with tempo
-void handleSetDigtemp(byte * payload, unsigned int length, int ActuatorId) {
-  if (!strncmp((char *)payload, "ON", length)) {
-    digitalWrite(actuator[ActuatorId].Pin, HIGH);
-  } else if (!strncmp((char *)payload, "OFF", length)) { 
-    digitalWrite(actuator[ActuatorId].Pin, LOW);
+// subMQTT - Parse a servo position (0-100, at most 3 digits)
+boolean parseSetPosition(const byte * payload, unsigned int length, s_command& cmd) {
+  if (length == 0 || length > 3) {
+    return false;
+  }
+
+  int pos = 0;
+  for (unsigned int i = 0; i < length; i++) {
+    if (payload[i] < '0' || payload[i] > '9') {
+      return false;
+    }
+    pos = pos * 10 + (payload[i] - '0');
+  }
+
+  if (pos > 100) {
+    return false;
+  }
+
+  cmd.Cmd = cPOSITION;
+  cmd.Value = pos;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// I/O - apply a queued command
+void applyCommand(const s_command& cmd) {
+  const s_actuator& a = actuator[cmd.ActuatorId];
+  DomServo* s = (a.Type == tSERVO) ? servoByPin(a.Pin) : NULL;
+
+  switch(cmd.Cmd) {
+    case cOPEN:
+      if (s) s->setOpen();
+      break;
+    case cCLOSE:
+      if (s) s->setClose();
+      break;
+    case cSTOP:
+      if (s) s->setStop();
+      break;
+    case cPOSITION:
+      if (s) s->goToPosition(cmd.Value);
+      break;
+    case cON:
+      digitalWrite(a.Pin, HIGH);
+#if defined(POWER_MANAGED)
+      outputsOn |= (1UL << cmd.ActuatorId);
+#endif
+      break;
+    case cOFF:
+      digitalWrite(a.Pin, LOW);
+#if defined(POWER_MANAGED)
+      outputsOn &= ~(1UL << cmd.ActuatorId);
+#endif
+      break;
+    default:
+      break;
   }
 }
 
 ////////////////////////////////////////////////////////////////////////
-// subMQTT - Set a servo position
-void handleSetPosition(byte * payload, unsigned int length, int ActuatorId) {
+// I/O - sample digital and analog sensors
+void sampleSensors() {
+  for (int i = 0; i < numberOfSensors; i++) {
+    s_snapshot snap = { sSENSOR, (uint8_t)i, 0, 0 };
+
+    if (sensor[i].Type == tDIGIN) {
+      snap.Value = digitalRead(sensor[i].Pin);
+    } else if (sensor[i].Type == tANIN) {
+      snap.Value = analogRead(sensor[i].Pin);
+    } else {
+      continue; // tTIC : TeleInfo::readTeleInfo() blocks until a full frame, not polled here
+    }
 
-  CmdServo& s = servoByPin(actuator[ActuatorId].Pin);
-  String myString = (char*)payload;
-  int pos = myString.toInt();
-  if(pos >= 0 && pos <= 100) {
-    s.goToPosition(pos);
+    tlmQueue.push(snap);
   }
 }
 
@@ -500,17 +896,75 @@ void addDevice(DynamicJsonDocument& root) {
 }
 
 ////////////////////////////////////////////////////////////////////////
-// subMQTT - publish debug topic
-void debugPrint(String message) {
-  if (debug) {
-    Serial.println(message);
-    // publish to debug topic
-    char t[MQTT_TOPIC_MAX_LENGTH];
-    sprintf(t, mqtt_debug_topic, client_id);
-    client.publish(t, message.c_str());
+// subMQTT - flush the debug log : text on serial, binary batches on debug topic
+// Serial always gets the records, batches not published are counted as dropped
+void flushLog() {
+  char t[MQTT_TOPIC_MAX_LENGTH];
+  sprintf(t, mqtt_debug_topic, client_id);
+
+  s_logBatch batch;
+  int count;
+  for (int n = 0; n < 4 && (count = debugLog.popBatch(batch)) > 0; n++) { // at most 4 batches per call
+    for (int i = 0; i < count; i++) {
+      char line[128];
+      debugLog.format(batch.Records[i], line, sizeof(line));
+      Serial.println(line);
+    }
+
+    if (!client.connected() || !client.publish(t, (const uint8_t*)&batch, sizeof(batch) - (LOG_BATCH - count) * sizeof(s_logRecord))) {
+      debugLog.countUnsent(count);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////
+// subMQTT - publish command queue metrics
+void publishMetrics() {
+  const s_cmdMetrics& m = cmdQueue.getMetrics();
+
+  DynamicJsonDocument root(512);
+  root["received"] = m.received;
+  root["rate_limited"] = m.rateLimited;
+  root["queue_full"] = m.queueFull;
+  root["malformed"] = m.malformed;
+  root["coalesced"] = m.coalesced;
+  root["applied"] = m.applied;
+  root["telemetry_dropped"] = tlmQueue.getDropped();
+  root["log_dropped"] = debugLog.getDropped();
+
+  JsonArray perActuator = root.createNestedArray("rate_limited_by_actuator");
+  for (int i = 0; i < numberOfActuators; i++) {
+    perActuator.add(cmdQueue.getRateLimited(i));
+  }
+
+  String mqttOutput;
+  serializeJson(root, mqttOutput);
+  if (!client.publish(mqtt_metrics_topic, mqttOutput.c_str())) {
+    debugLog.write(lWARN, fMQTT_PUBLISH_FAILED, 0, mqttOutput.length());
   }
 }
 
+#if defined(POWER_MANAGED)
+////////////////////////////////////////////////////////////////////////
+// subMQTT - publish power counters, residency in ms per mode since cold boot
+void publishPower() {
+  DynamicJsonDocument root(256);
+  for (int i = 0; i < POWER_MODE_COUNT; i++) {
+    root[PowerManager::getModeName((e_powerMode)i)] = powerManager.getResidency((e_powerMode)i);
+  }
+  root["duty_cycle"] = powerManager.getDutyCycle(); // per mille
+  root["wakeups"] = powerManager.getWakeups();
+  root["wake_error_max"] = powerManager.getWakeErrorMax();
+  root["wake_error_avg"] = powerManager.getWakeErrorAvg();
+
+  String mqttOutput;
+  serializeJson(root, mqttOutput);
+  if (!client.publish(mqtt_power_topic, mqttOutput.c_str())) {
+    debugLog.write(lWARN, fMQTT_PUBLISH_FAILED, 1, mqttOutput.length());
+  }
+}
+#endif
+
 ////////////////////////////////////////////////////////////////////////
 // CmdServo - position changed -> Do nothing
 void positionChanged(int servoId) {
@@ -518,23 +972,46 @@ void positionChanged(int servoId) {
 }
 
 ////////////////////////////////////////////////////////////////////////
-// CmdServo - status changed -> MQTT-publish status and position
+// CmdServo - status changed -> queue status and position for the network side
+// Topics use the actuator index, like the config and the commands
 void statusChanged(int servoId) {
-  CmdServo& s = servoById(servoId);
+  DomServo* s = servoById(servoId);
+  if (s == NULL) {
+    return;
+  }
+  int actuatorId = actuatorByPin(tSERVO, s->getPin());
+  if (actuatorId < 0) {
+    return;
+  }
+
+  s_snapshot snap = { sSERVO, (uint8_t)actuatorId, (int16_t)s->getStatus(), (int16_t)s->currentAngleInPercent() };
+  tlmQueue.push(snap);
+}
+
+////////////////////////////////////////////////////////////////////////
+// subMQTT - publish a snapshot from the I/O side
+void publishSnapshot(const s_snapshot& snap) {
+  if (snap.Kind == sSENSOR) {
+    char t[MQTT_TOPIC_MAX_LENGTH];
+    sprintf(t, mqtt_sensor_topic, sensor[snap.Id].name);
+    client.publish(t, String(snap.Value).c_str());
+    return;
+  }
 
+  int actuatorId = snap.Id;
   String statusMsg = "OPEN";
 
-  switch(s.getStatus()) {
-    case CmdServo::OPEN:
+  switch((CmdServoBase::CmdStatus)snap.State) {
+    case CmdServoBase::OPEN:
       statusMsg = "open";
       break;
-    case CmdServo::CLOSED:
+    case CmdServoBase::CLOSED:
       statusMsg = "closed";
       break;
-    case CmdServo::CLOSING:
+    case CmdServoBase::CLOSING:
       statusMsg = "closing";
       break;
-    case CmdServo::OPENING:
+    case CmdServoBase::OPENING:
       statusMsg = "opening";
       break;
     default:
@@ -543,11 +1020,11 @@ void statusChanged(int servoId) {
 
   // Publish status
   char t[MQTT_TOPIC_MAX_LENGTH];
-  sprintf(t, mqtt_state_topic, servoId);
+  sprintf(t, mqtt_state_topic, actuatorId);
   client.publish(t, statusMsg.c_str(), retain_status);
 
   // Publish position
   char position_t[MQTT_TOPIC_MAX_LENGTH];
-  sprintf(position_t, mqtt_position_topic, servoId);
-  client.publish(position_t, String(s.currentAngleInPercent()).c_str(), retain_position);
+  sprintf(position_t, mqtt_position_topic, actuatorId);
+  client.publish(position_t, String(snap.Value).c_str(), retain_position);
 }
@@ -0,0 +1,26 @@
+#ifndef LOGFORMATS_H
+#define LOGFORMATS_H
+
+////////////////////////////////////////////////////////////////////////
+// Log formats, shared by the firmware (DebugLog) and tools/logdecode.py
+// The id of a format is its position in the list : only append.
+// Arguments are two int32, use %d / %u / %x only.
+#define LOG_FORMATS(X) \
+  X(fSERVO_GO_TO_ANGLE,          "(%d) Go to angle: %d") \
+  X(fSERVO_STOP,                 "(%d) Stop moving at angle: %d") \
+  X(fSUBSCRIBED_SET,             "Subscribed to set topic (%d)") \
+  X(fSUBSCRIBE_SET_FAILED,       "Failed to subscribe to set topic (%d)") \
+  X(fSUBSCRIBED_POSITION,        "Subscribed to set position topic (%d)") \
+  X(fSUBSCRIBE_POSITION_FAILED,  "Failed to subscribe to set position topic (%d)") \
+  X(fMQTT_RECONNECT,             "MQTT reconnect, state %d") \
+  X(fMQTT_RECEIVED,              "MQTT message for actuator %d, %d bytes") \
+  X(fMQTT_MALFORMED,             "Malformed MQTT message for actuator %d, %d bytes") \
+  X(fMQTT_PUBLISH_FAILED,        "MQTT publish failed (%d : metrics, power), %d bytes") \
+  X(fWIFI_RESUME_FAILED,         "WiFi not back after %d ms, status %d")
+
+#define LOG_FORMAT_ID(id, text) id,
+#define LOG_FORMAT_TEXT(id, text) text,
+
+enum e_logFormat { LOG_FORMATS(LOG_FORMAT_ID) LOG_FORMAT_COUNT };
+
+#endif
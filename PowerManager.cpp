@@ -0,0 +1,124 @@
+#include <string.h>
+
+#include "PowerManager.h"
+
+static const char* const powerModeNames[] = { "busy", "modem", "light", "deep" };
+
+PowerManager::PowerManager(unsigned long modemMin, unsigned long lightMin, unsigned long deepMin, unsigned long linkMax) {
+  this->modemMin = modemMin;
+  this->lightMin = lightMin;
+  this->deepMin = deepMin;
+  this->linkMax = linkMax;
+  awakeTime = 0;
+  windowEnd = 0;
+  awakeSince = 0;
+  memset(&state, 0, sizeof(state));
+}
+
+void PowerManager::begin(unsigned long now, unsigned long awakeTime) {
+  this->awakeTime = awakeTime;
+  awakeSince = now;
+  openWindow(now);
+}
+
+e_powerMode PowerManager::step(unsigned long now, unsigned long deadline, bool busy, bool deepAllowed, bool linkRequired, unsigned long& duration) {
+  unsigned long idle = (long)(deadline - now) > 0 ? deadline - now : 0;
+  bool windowOpen = (long)(windowEnd - now) > 0;
+
+  duration = 0;
+  e_powerMode mode = choose(idle, busy || windowOpen, deepAllowed, linkRequired);
+  if (mode == pBUSY) {
+    return pBUSY;
+  }
+
+  account(pBUSY, now - awakeSince);
+  awakeSince = now;
+  duration = limit(idle, linkRequired);
+  return mode;
+}
+
+void PowerManager::resume(e_powerMode mode, unsigned long requested, unsigned long slept, unsigned long now) {
+  wokeUp(mode, requested, slept);
+  awakeSince = now;
+
+  if (mode == pLIGHT_SLEEP || mode == pDEEP_SLEEP) {
+    openWindow(now); // new window : sample, then MQTT exchange
+  }
+}
+
+void PowerManager::openWindow(unsigned long now) {
+  windowEnd = now + awakeTime;
+}
+
+e_powerMode PowerManager::choose(unsigned long idle, bool busy, bool deepAllowed, bool linkRequired) {
+  if (busy || idle < modemMin) {
+    return pBUSY;
+  } else if (linkRequired || idle < lightMin) {
+    return pMODEM_SLEEP;
+  } else if (idle < deepMin || !deepAllowed) {
+    return pLIGHT_SLEEP;
+  }
+
+  return pDEEP_SLEEP;
+}
+
+unsigned long PowerManager::limit(unsigned long idle, bool linkRequired) {
+  if (linkRequired && idle > linkMax) {
+    return linkMax;
+  }
+  return idle;
+}
+
+void PowerManager::account(e_powerMode mode, unsigned long duration) {
+  state.Residency[mode] += duration;
+}
+
+void PowerManager::wokeUp(e_powerMode mode, unsigned long requested, unsigned long slept) {
+  account(mode, slept);
+
+  uint32_t error = slept > requested ? slept - requested : requested - slept;
+  if (error > state.WakeErrorMax) {
+    state.WakeErrorMax = error;
+  }
+  state.WakeErrorSum += error;
+  state.Wakeups++;
+}
+
+uint32_t PowerManager::getResidency(e_powerMode mode) {
+  return state.Residency[mode];
+}
+
+uint32_t PowerManager::getDutyCycle() {
+  uint64_t total = 0;
+  for (int i = 0; i < POWER_MODE_COUNT; i++) {
+    total += state.Residency[i];
+  }
+  if (total == 0) {
+    return 1000;
+  }
+  return (uint32_t)(((uint64_t)state.Residency[pBUSY] + state.Residency[pMODEM_SLEEP]) * 1000 / total);
+}
+
+uint32_t PowerManager::getWakeups() {
+  return state.Wakeups;
+}
+
+uint32_t PowerManager::getWakeErrorMax() {
+  return state.WakeErrorMax;
+}
+
+uint32_t PowerManager::getWakeErrorAvg() {
+  return state.Wakeups ? state.WakeErrorSum / state.Wakeups : 0;
+}
+
+const char* PowerManager::getModeName(e_powerMode mode) {
+  return mode < POWER_MODE_COUNT ? powerModeNames[mode] : "?";
+}
+
+const s_powerState& PowerManager::getState() {
+  return state;
+}
+
+void PowerManager::restore(const s_powerState& state) {
+  this->state = state;
+}
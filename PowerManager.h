@@ -0,0 +1,86 @@
+#ifndef POWERMANAGER_H
+#define POWERMANAGER_H
+
+#include <stdint.h>
+
+#ifndef POWER_MODEM_MIN
+#define POWER_MODEM_MIN 10 // ms idle before modem sleep, below : busy loop
+#endif
+#ifndef POWER_LIGHT_MIN
+#define POWER_LIGHT_MIN 200 // ms idle before light sleep
+#endif
+#ifndef POWER_DEEP_MIN
+#define POWER_DEEP_MIN 60000 // ms idle before deep sleep (reboot + wifi reconnect cost)
+#endif
+#ifndef POWER_LINK_MAX
+#define POWER_LINK_MAX 100 // ms of sleep at once while the link must stay up (output ON)
+#endif
+
+enum e_powerMode { pBUSY, pMODEM_SLEEP, pLIGHT_SLEEP, pDEEP_SLEEP, POWER_MODE_COUNT };
+
+// Counters, kept in RTC memory across deep sleep
+struct s_powerState {
+  uint32_t Residency[POWER_MODE_COUNT]; // ms spent in each mode
+  uint32_t Wakeups;
+  uint32_t WakeErrorMax; // ms, |slept - requested|
+  uint32_t WakeErrorSum;
+};
+
+////////////////////////////////////////////////////////////////////////
+// Power manager
+// step() picks the deepest mode that fits the time left before the next
+// deadline, once the wake-up window is over and the I/O side is idle.
+// resume() counts the sleep and opens a new window after light or deep
+// sleep. It keeps residency / wake-up accuracy counters.
+// While the link must stay up (an output is ON and must be switched OFF
+// on command), only modem sleep is allowed, by steps of linkMax ms.
+// It gets the time as arguments, it never reads the clock, so powerStep()
+// and host/PowerManagerTest.cpp (virtual clock) run the same decisions.
+
+class PowerManager {
+  public:
+    PowerManager(unsigned long modemMin = POWER_MODEM_MIN, unsigned long lightMin = POWER_LIGHT_MIN, unsigned long deepMin = POWER_DEEP_MIN, unsigned long linkMax = POWER_LINK_MAX);
+
+    // First wake-up window, at boot
+    void begin(unsigned long now, unsigned long awakeTime);
+
+    // Decision step : mode and duration of the sleep to take now, pBUSY : none
+    e_powerMode step(unsigned long now, unsigned long deadline, bool busy, bool deepAllowed, bool linkRequired, unsigned long& duration);
+    // After the sleep : counters, and a new window after light / deep sleep
+    void resume(e_powerMode mode, unsigned long requested, unsigned long slept, unsigned long now);
+    void openWindow(unsigned long now); // e.g. again once the link is back
+
+    // Mode for the next idle ms, and how long to stay in it
+    e_powerMode choose(unsigned long idle, bool busy, bool deepAllowed, bool linkRequired = false);
+    unsigned long limit(unsigned long idle, bool linkRequired);
+
+    // Accounting
+    void account(e_powerMode mode, unsigned long duration);
+    void wokeUp(e_powerMode mode, unsigned long requested, unsigned long slept);
+
+    // Getters
+    uint32_t getResidency(e_powerMode mode);
+    uint32_t getDutyCycle(); // CPU awake (busy + modem sleep), per mille
+    uint32_t getWakeups();
+    uint32_t getWakeErrorMax();
+    uint32_t getWakeErrorAvg();
+    static const char* getModeName(e_powerMode mode);
+
+    // Deep sleep persistence
+    const s_powerState& getState();
+    void restore(const s_powerState& state);
+
+  private:
+    unsigned long modemMin;
+    unsigned long lightMin;
+    unsigned long deepMin;
+    unsigned long linkMax;
+
+    unsigned long awakeTime;
+    unsigned long windowEnd;  // wake-up window : stay awake until then
+    unsigned long awakeSince; // for busy residency
+
+    s_powerState state;
+};
+
+#endif
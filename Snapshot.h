@@ -0,0 +1,19 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+
+////////////////////////////////////////////////////////////////////////
+// Shared records between network and I/O sides (see SpscQueue.h)
+// Commands (network -> I/O) are in CmdQueue.h
+enum e_snapshot { sSERVO, sSENSOR };
+
+// Snapshot : I/O -> network
+struct s_snapshot {
+  e_snapshot Kind;
+  uint8_t Id;     // actuator index or sensor index
+  int16_t State;  // CmdServo::CmdStatus for servos
+  int16_t Value;  // position in percent, or sensor reading
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+////////////////////////////////////////////////////////////////////////
+// Lock-free single producer / single consumer ring buffer
+// One task pushes, one other task pops. No lock, no heap.
+// Size must be a power of two, one slot is kept free (capacity = N - 1).
+// Only depends on <atomic>, so it also builds on host (std::thread).
+
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+  public:
+    SpscQueue() : head(0), tail(0), dropped(0) {}
+
+    // Producer side - returns false (and counts a drop) when full
+    bool push(const T& item) {
+      size_t h = head.load(std::memory_order_relaxed);
+      size_t next = (h + 1) & (N - 1);
+      if (next == tail.load(std::memory_order_acquire)) {
+        dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+      }
+      buffer[h] = item;
+      head.store(next, std::memory_order_release);
+      return true;
+    }
+
+    // Consumer side - returns false when empty
+    bool pop(T& item) {
+      size_t t = tail.load(std::memory_order_relaxed);
+      if (t == head.load(std::memory_order_acquire)) {
+        return false;
+      }
+      item = buffer[t];
+      tail.store((t + 1) & (N - 1), std::memory_order_release);
+      return true;
+    }
+
+    // Getters (approximate when read from the other side)
+    bool isEmpty() const {
+      return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+    size_t size() const {
+      return (head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire)) & (N - 1);
+    }
+    size_t capacity() const {
+      return N - 1;
+    }
+    uint32_t getDropped() const {
+      return dropped.load(std::memory_order_relaxed);
+    }
+
+  private:
+    T buffer[N];
+    std::atomic<size_t> head; // written by producer
+    std::atomic<size_t> tail; // written by consumer
+    std::atomic<uint32_t> dropped; // written by producer
+};
+
+#endif
@@ -0,0 +1,153 @@
+////////////////////////////////////////////////////////////////////////
+// Host test of CmdQueue (see CmdQueue.h)
+// Push, collect and pop on a virtual clock, one thread : checks that the
+// last target of an actuator always wins, even when the rate limit holds
+// it, and that the rate limit bounds how often a slot is applied.
+// Exit code is not 0 when a check fails.
+////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#include <stdio.h>
+
+#include "CmdQueue.h"
+
+#define TEST_TURN_TIME 50 // turnTime, ms (DomObj.h)
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+// ioStep() at tick time : returns the number of commands applied, last one in last
+static int tick(CmdQueue& queue, unsigned long now, s_command& last) {
+  int count = 0;
+  s_command cmd;
+  queue.collect();
+  while (queue.pop(cmd, now)) {
+    last = cmd;
+    count++;
+  }
+  return count;
+}
+
+////////////////////////////////////////////////////////////////////////
+// A burst of positions is applied once, with the last target
+static void testBurstLastWins() {
+  CmdQueue queue;
+  for (int i = 0; i < 15; i++) {
+    s_command cmd = { 0, cPOSITION, (int16_t)i };
+    CHECK(queue.push(cmd));
+  }
+
+  s_command last = { 0, cSTOP, -1 };
+  CHECK(tick(queue, 0, last) == 1);
+  CHECK(last.Cmd == cPOSITION && last.Value == 14);
+  CHECK(queue.getMetrics().coalesced == 14);
+  CHECK(queue.getMetrics().rateLimited == 0);
+  CHECK(!queue.hasPending());
+}
+
+////////////////////////////////////////////////////////////////////////
+// A pump toggled faster than the rate limit ends OFF
+static void testToggleEndsOff() {
+  CmdQueue queue;
+  s_command last = { 0, cSTOP, 0 };
+  unsigned long now = 0;
+
+  // 31 toggles, one every 10 ms, one tick each : ON, OFF, ... ON, OFF
+  for (int i = 0; i < 31; i++, now += 10) {
+    s_command cmd = { 3, i % 2 ? cOFF : cON, 0 };
+    if (i == 30) {
+      cmd.Cmd = cOFF;
+    }
+    CHECK(queue.push(cmd));
+    tick(queue, now, last);
+  }
+  CHECK(queue.getMetrics().rateLimited > 0);
+
+  // The held OFF goes out as soon as a token is back
+  for (; now < 1000 && queue.hasPending(); now += TEST_TURN_TIME) {
+    tick(queue, now, last);
+  }
+  CHECK(!queue.hasPending());
+  CHECK(last.ActuatorId == 3 && last.Cmd == cOFF);
+  CHECK(now <= 300 + 1000 / CMDQUEUE_RATE);
+}
+
+////////////////////////////////////////////////////////////////////////
+// A flood is applied at most at the rate limit, and its last target wins
+static void testRate() {
+  CmdQueue queue;
+  s_command last = { 0, cSTOP, 0 };
+  int applied = 0;
+  int16_t value = 0;
+
+  // One command every 10 ms for 10 s, tick every 50 ms
+  for (unsigned long now = 0; now < 10000; now += 10) {
+    s_command cmd = { 1, cPOSITION, value++ };
+    queue.push(cmd);
+    if (now % TEST_TURN_TIME == 0) {
+      applied += tick(queue, now, last);
+    }
+  }
+  applied += tick(queue, 10000 + 1000 / CMDQUEUE_RATE, last);
+
+  printf("rate       : %d commands, %d applied, %lu coalesced, %lu rate limited\n",
+         value, applied, (unsigned long)queue.getMetrics().coalesced, (unsigned long)queue.getMetrics().rateLimited);
+
+  CHECK(applied <= CMDQUEUE_BURST + CMDQUEUE_RATE * 10 + 1);
+  CHECK(applied >= CMDQUEUE_RATE * 10);
+  CHECK(last.Value == value - 1);
+  CHECK(queue.getRateLimited(1) == queue.getMetrics().rateLimited);
+  CHECK(queue.getMetrics().applied + queue.getMetrics().coalesced == queue.getMetrics().received);
+}
+
+////////////////////////////////////////////////////////////////////////
+// A held actuator does not hold the others
+static void testIndependentActuators() {
+  CmdQueue queue;
+  s_command last = { 0, cSTOP, 0 };
+
+  for (int i = 0; i < CMDQUEUE_BURST; i++) {
+    s_command cmd = { 0, cPOSITION, (int16_t)i };
+    queue.push(cmd);
+    tick(queue, 0, last);
+  }
+  s_command held = { 0, cPOSITION, 50 };
+  s_command other = { 2, cPOSITION, 70 };
+  queue.push(held);
+  queue.push(other);
+
+  CHECK(tick(queue, 0, last) == 1);
+  CHECK(last.ActuatorId == 2 && last.Value == 70);
+  CHECK(queue.getRateLimited(0) == 1);
+  CHECK(queue.hasPending());
+
+  CHECK(tick(queue, 1000 / CMDQUEUE_RATE, last) == 1);
+  CHECK(last.ActuatorId == 0 && last.Value == 50);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Out of range actuator
+static void testMalformed() {
+  CmdQueue queue;
+  s_command cmd = { CMDQUEUE_MAX_ACTUATORS, cON, 0 };
+  CHECK(!queue.push(cmd));
+  CHECK(queue.getMetrics().malformed == 1);
+  CHECK(queue.getMetrics().received == 0);
+  CHECK(queue.getRateLimited(-1) == 0);
+}
+
+int main() {
+  testBurstLastWins();
+  testToggleEndsOff();
+  testRate();
+  testIndependentActuators();
+  testMalformed();
+
+  printf("%s, %d failure(s)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}
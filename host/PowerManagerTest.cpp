@@ -0,0 +1,257 @@
+////////////////////////////////////////////////////////////////////////
+// Host test of PowerManager (see PowerManager.h)
+// Runs the decision step used by powerStep() (begin / step / resume /
+// openWindow) on a virtual clock, with a simulated I/O side that samples
+// the sensors at their deadline. Sleeps end early or late by a
+// pseudo-random amount, light sleep wake-ups pay a link reconnect time.
+// Checks that samples follow their deadlines, that nothing sleeps while
+// the I/O side is busy or inside a window, the wake-up counters and the
+// duty cycle.
+// Exit code is not 0 when a check fails.
+////////////////////////////////////////////////////////////////////////
+#include <stdint.h>
+#include <stdio.h>
+
+#include "PowerManager.h"
+
+// ARROSLR profile timings (DomObj.h)
+#define TEST_SENSOR_TIME 600000UL
+#define TEST_AWAKE_TIME 3000UL
+#define TEST_HOUR 3600000UL
+#define TEST_DAY 86400000UL
+
+#define TEST_JITTER_MAX 4     // ms, a sleep ends up to this early or late
+#define TEST_LINK_RESUME 1500 // ms, WiFi + MQTT after a light sleep
+#define TEST_IO_BUSY 5000     // ms, servo move started at the top of each hour
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+      failures++; \
+    } \
+  } while (0)
+
+// Deterministic error in [-TEST_JITTER_MAX, TEST_JITTER_MAX]
+static long jitter() {
+  static uint32_t seed = 12345;
+  seed = seed * 1103515245UL + 12345UL;
+  return (long)((seed >> 16) % (2 * TEST_JITTER_MAX + 1)) - TEST_JITTER_MAX;
+}
+
+struct s_simResult {
+  unsigned long Samples;
+  unsigned long MaxLateness;  // ms, sample time - sample deadline
+  unsigned long MaxSleep;     // ms, longest single sleep
+  unsigned long MinAwake;     // ms, wake-up from light / deep sleep -> next sleep
+  unsigned long SleepsInBusy; // sleeps started while the I/O side was busy
+  unsigned long SleepsInWindow;
+};
+
+////////////////////////////////////////////////////////////////////////
+// netTask (powerStep) and ioTask (ioStep) on one virtual clock
+static s_simResult simulate(PowerManager& pm, unsigned long duration, bool deepAllowed, bool linkRequired) {
+  s_simResult result = { 1, 0, 0, (unsigned long)-1, 0, 0 }; // first sample at boot
+  unsigned long now = 0;
+  unsigned long sensorStart = 0;
+  unsigned long ioBusyUntil = 0;
+  unsigned long windowStart = 0;
+  bool fromSleep = false;
+  unsigned long lastHour = 0;
+
+  // ioStep(), samples at the deadline, a servo move at the top of each hour
+  auto ioStep = [&]() {
+    if (now >= duration) {
+      return; // only the deadlines inside the run
+    }
+    if (now - sensorStart >= TEST_SENSOR_TIME) {
+      unsigned long lateness = now - (sensorStart + TEST_SENSOR_TIME);
+      if (lateness > result.MaxLateness) {
+        result.MaxLateness = lateness;
+      }
+      sensorStart = now;
+      result.Samples++;
+    }
+    if (now / TEST_HOUR != lastHour) {
+      lastHour = now / TEST_HOUR;
+      ioBusyUntil = now + TEST_IO_BUSY;
+    }
+  };
+
+  pm.begin(now, TEST_AWAKE_TIME);
+
+  while (now < duration) {
+    ioStep();
+    bool ioBusy = now < ioBusyUntil;
+
+    // powerStep()
+    unsigned long sleepFor;
+    e_powerMode mode = pm.step(now, sensorStart + TEST_SENSOR_TIME, ioBusy, deepAllowed, linkRequired, sleepFor);
+    if (mode == pBUSY) {
+      now++; // one loop turn
+      continue;
+    }
+
+    if (ioBusy) {
+      result.SleepsInBusy++;
+    }
+    if (fromSleep) {
+      if (now - windowStart < TEST_AWAKE_TIME) {
+        result.SleepsInWindow++;
+      }
+      if (now - windowStart < result.MinAwake) {
+        result.MinAwake = now - windowStart;
+      }
+    }
+
+    long error = jitter();
+    unsigned long slept = (long)sleepFor + error > 0 ? sleepFor + error : 0;
+    now += slept;
+    pm.resume(mode, sleepFor, slept, now);
+
+    if (slept > result.MaxSleep) {
+      result.MaxSleep = slept;
+    }
+    if (mode == pLIGHT_SLEEP) {
+      // linkResume() blocks netTask, ioTask keeps running on its core
+      for (unsigned long end = now + TEST_LINK_RESUME; now < end; now++) {
+        ioStep();
+      }
+      pm.openWindow(now);
+    }
+    if (mode == pLIGHT_SLEEP || mode == pDEEP_SLEEP) {
+      fromSleep = true;
+      windowStart = now;
+    }
+  }
+
+  return result;
+}
+
+static void printState(const char* name, PowerManager& pm, const s_simResult& r) {
+  printf("%-14s:", name);
+  for (int i = 0; i < POWER_MODE_COUNT; i++) {
+    printf(" %s %lu ms", PowerManager::getModeName((e_powerMode)i), (unsigned long)pm.getResidency((e_powerMode)i));
+  }
+  printf(", duty %lu/1000, %lu wake-ups, error max %lu ms avg %lu ms, %lu samples, late max %lu ms\n",
+         (unsigned long)pm.getDutyCycle(), (unsigned long)pm.getWakeups(),
+         (unsigned long)pm.getWakeErrorMax(), (unsigned long)pm.getWakeErrorAvg(), r.Samples, r.MaxLateness);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Thresholds
+static void testChoose() {
+  PowerManager pm;
+
+  CHECK(pm.choose(POWER_MODEM_MIN - 1, false, true) == pBUSY);
+  CHECK(pm.choose(POWER_DEEP_MIN, true, true) == pBUSY);
+  CHECK(pm.choose(POWER_MODEM_MIN, false, true) == pMODEM_SLEEP);
+  CHECK(pm.choose(POWER_LIGHT_MIN, false, true) == pLIGHT_SLEEP);
+  CHECK(pm.choose(POWER_DEEP_MIN, false, false) == pLIGHT_SLEEP);
+  CHECK(pm.choose(POWER_DEEP_MIN, false, true) == pDEEP_SLEEP);
+
+  // Output ON : modem sleep only, by steps of POWER_LINK_MAX
+  CHECK(pm.choose(TEST_SENSOR_TIME, false, true, true) == pMODEM_SLEEP);
+  CHECK(pm.choose(POWER_MODEM_MIN - 1, false, true, true) == pBUSY);
+  CHECK(pm.limit(TEST_SENSOR_TIME, true) == POWER_LINK_MAX);
+  CHECK(pm.limit(POWER_LINK_MAX / 2, true) == POWER_LINK_MAX / 2);
+  CHECK(pm.limit(TEST_SENSOR_TIME, false) == TEST_SENSOR_TIME);
+
+  // Empty counters
+  CHECK(pm.getDutyCycle() == 1000);
+  CHECK(pm.getWakeErrorAvg() == 0);
+}
+
+////////////////////////////////////////////////////////////////////////
+// Window and deadline
+static void testStep() {
+  PowerManager pm;
+  unsigned long duration;
+  pm.begin(1000, TEST_AWAKE_TIME);
+
+  // Inside the window, then after it : sleep until the deadline
+  CHECK(pm.step(1000 + TEST_AWAKE_TIME - 1, 100000, false, true, false, duration) == pBUSY);
+  CHECK(pm.step(1000 + TEST_AWAKE_TIME, 100000, false, true, false, duration) == pDEEP_SLEEP);
+  CHECK(duration == 100000 - 1000 - TEST_AWAKE_TIME);
+  CHECK(pm.getResidency(pBUSY) == TEST_AWAKE_TIME);
+
+  // Late wake-up : deadline passed, no sleep
+  pm.resume(pDEEP_SLEEP, duration, duration + 10, 100010);
+  CHECK(pm.getWakeErrorMax() == 10);
+  CHECK(pm.step(100010 + TEST_AWAKE_TIME, 100000, false, true, false, duration) == pBUSY);
+
+  // Window reopened by resume() after deep sleep
+  CHECK(pm.step(100010 + TEST_AWAKE_TIME - 1, 800000, false, true, false, duration) == pBUSY);
+  CHECK(pm.step(100010 + TEST_AWAKE_TIME, 800000, true, true, false, duration) == pBUSY);
+
+  // Modem sleep does not reopen the window
+  CHECK(pm.step(100010 + TEST_AWAKE_TIME, 100010 + TEST_AWAKE_TIME + 50, false, true, false, duration) == pMODEM_SLEEP);
+  pm.resume(pMODEM_SLEEP, duration, duration, 100010 + TEST_AWAKE_TIME + 50);
+  CHECK(pm.step(100010 + TEST_AWAKE_TIME + 50, 800000, false, true, false, duration) == pDEEP_SLEEP);
+}
+
+////////////////////////////////////////////////////////////////////////
+// One day, nothing ON : deep sleep between samples
+static void testDeepSleepDay() {
+  PowerManager pm;
+  s_simResult r = simulate(pm, TEST_DAY, true, false);
+  printState("deep, 24 h", pm, r);
+
+  CHECK(r.Samples == TEST_DAY / TEST_SENSOR_TIME);
+  CHECK(r.MaxLateness <= TEST_JITTER_MAX); // wake-ups follow the deadlines
+  CHECK(r.SleepsInBusy == 0);
+  CHECK(r.SleepsInWindow == 0);
+  CHECK(pm.getResidency(pDEEP_SLEEP) > 0);
+  CHECK(pm.getResidency(pLIGHT_SLEEP) == 0);
+  CHECK(pm.getDutyCycle() <= 20); // awake 3 s every 10 min + 5 s busy per hour
+  CHECK(pm.getWakeErrorMax() <= TEST_JITTER_MAX);
+  CHECK(pm.getWakeErrorMax() >= r.MaxLateness);
+}
+
+////////////////////////////////////////////////////////////////////////
+// One day, servos present : light sleep, the window starts once the link is back
+static void testLightSleepDay() {
+  PowerManager pm;
+  s_simResult r = simulate(pm, TEST_DAY, false, false);
+  printState("light, 24 h", pm, r);
+
+  CHECK(r.Samples == TEST_DAY / TEST_SENSOR_TIME);
+  CHECK(r.MaxLateness <= TEST_JITTER_MAX);
+  CHECK(r.SleepsInBusy == 0);
+  CHECK(r.SleepsInWindow == 0);
+  CHECK(r.MinAwake >= TEST_AWAKE_TIME);
+  CHECK(pm.getResidency(pDEEP_SLEEP) == 0);
+  CHECK(pm.getResidency(pLIGHT_SLEEP) > 0);
+  CHECK(pm.getResidency(pBUSY) >= (TEST_DAY / TEST_SENSOR_TIME - 1) * (TEST_AWAKE_TIME + TEST_LINK_RESUME));
+  CHECK(pm.getDutyCycle() <= 20);
+  CHECK(pm.getWakeErrorMax() <= TEST_JITTER_MAX);
+}
+
+////////////////////////////////////////////////////////////////////////
+// One hour, output ON : never out of reach longer than POWER_LINK_MAX
+static void testOutputOnHour() {
+  PowerManager pm;
+  s_simResult r = simulate(pm, TEST_HOUR, true, true);
+  printState("output ON, 1 h", pm, r);
+
+  CHECK(r.Samples == TEST_HOUR / TEST_SENSOR_TIME);
+  CHECK(r.MaxLateness <= TEST_JITTER_MAX);
+  CHECK(r.SleepsInBusy == 0);
+  CHECK(pm.getResidency(pLIGHT_SLEEP) == 0);
+  CHECK(pm.getResidency(pDEEP_SLEEP) == 0);
+  CHECK(pm.getResidency(pMODEM_SLEEP) > 0);
+  CHECK(r.MaxSleep <= POWER_LINK_MAX + TEST_JITTER_MAX);
+  CHECK(pm.getDutyCycle() == 1000); // modem sleep keeps the CPU awake
+}
+
+int main() {
+  testChoose();
+  testStep();
+  testDeepSleepDay();
+  testLightSleepDay();
+  testOutputOnHour();
+
+  printf("%s, %d failure(s)\n", failures ? "FAILED" : "OK", failures);
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,230 @@
+////////////////////////////////////////////////////////////////////////
+// Host benchmark of the network / I/O split (see SpscQueue.h, CmdQueue.h)
+// Two std::thread play netTask and ioTask with the firmware queues:
+//   1. throughput : raw SpscQueue of s_command, checksum checked
+//   2. paced : commands under the rate limit, pushed into CmdQueue,
+//      collected every I/O turn, applied at the turnTime tick and answered
+//      with a s_snapshot; the latency is push -> snapshot back on the
+//      network side, so it includes the wait for the tick
+//   3. flood : more commands than the rate limit, reports coalescing and
+//      fails unless the last target of each actuator was applied
+// Exit code is not 0 when an item is lost or corrupted.
+////////////////////////////////////////////////////////////////////////
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <stdint.h>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "SpscQueue.h"
+#include "CmdQueue.h"
+#include "Snapshot.h"
+
+// Same values as the firmware (DomObj.h)
+#define BENCH_TLM_QUEUE_SIZE 32 // TLM_QUEUE_SIZE
+#define BENCH_TURN_TIME 50      // turnTime, ms
+
+#define BENCH_ITEMS 2000000UL // throughput run
+#define BENCH_ACTUATORS 8
+#define BENCH_VALUES 101      // positions 0-100
+#define BENCH_DRAIN_MS 500    // wait for the last snapshots
+
+typedef std::chrono::steady_clock benchClock;
+
+struct s_benchRun {
+  unsigned long Sent;
+  unsigned long Snapshots;
+  int LastKept;                 // actuators whose last target was applied
+  std::vector<int64_t> Latency; // ns, push -> snapshot on the network side
+  s_cmdMetrics Metrics;
+  uint32_t TlmDropped;
+};
+
+static int64_t nowNs() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(benchClock::now().time_since_epoch()).count();
+}
+
+static int64_t percentile(std::vector<int64_t>& values, double p) {
+  if (values.empty()) {
+    return 0;
+  }
+  size_t index = (size_t)(p * (values.size() - 1));
+  std::nth_element(values.begin(), values.begin() + index, values.end());
+  return values[index];
+}
+
+// vTaskDelay(1)
+static void taskDelay() {
+  std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+////////////////////////////////////////////////////////////////////////
+// 1. Throughput
+static bool benchThroughput() {
+  static SpscQueue<s_command, CMDQUEUE_FIFO_SIZE> fifo;
+  uint64_t expected = 0;
+  uint64_t received = 0;
+  unsigned long count = 0;
+
+  for (unsigned long i = 0; i < BENCH_ITEMS; i++) {
+    expected += i & 0x7FFF;
+  }
+
+  int64_t start = nowNs();
+
+  std::thread io([&]() {
+    s_command cmd;
+    while (count < BENCH_ITEMS) {
+      if (fifo.pop(cmd)) {
+        received += cmd.Value;
+        count++;
+      } else {
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  std::thread net([&]() {
+    s_command cmd = { 0, cPOSITION, 0 };
+    for (unsigned long i = 0; i < BENCH_ITEMS; i++) {
+      cmd.Value = (int16_t)(i & 0x7FFF);
+      while (!fifo.push(cmd)) {
+        std::this_thread::yield(); // full, let the consumer run
+      }
+    }
+  });
+
+  net.join();
+  io.join();
+
+  double seconds = (nowNs() - start) / 1e9;
+  printf("throughput : %lu commands in %.3f s, %.2f M/s, %u full pushes retried\n",
+         count, seconds, count / seconds / 1e6, (unsigned)fifo.getDropped());
+
+  if (received != expected) {
+    printf("throughput : checksum mismatch %llu != %llu\n", (unsigned long long)received, (unsigned long long)expected);
+    return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////
+// netStep() / ioStep() on two threads, one command every intervalUs
+static void runSplit(unsigned long intervalUs, unsigned long durationMs, s_benchRun& run) {
+  CmdQueue cmdQueue;
+  SpscQueue<s_snapshot, BENCH_TLM_QUEUE_SIZE> tlmQueue;
+
+  static int64_t sentNs[BENCH_ACTUATORS][BENCH_VALUES];
+  int lastSent[BENCH_ACTUATORS];
+  int lastApplied[BENCH_ACTUATORS];
+  for (int i = 0; i < BENCH_ACTUATORS; i++) {
+    lastSent[i] = lastApplied[i] = -1;
+  }
+
+  std::atomic<bool> done(false);
+  const int64_t start = nowNs();
+  auto uptime = [start]() { return (unsigned long)((nowNs() - start) / 1000000); };
+
+  run.Sent = 0;
+  run.Snapshots = 0;
+  run.Latency.clear();
+
+  // ioStep() : collect every turn, apply at the tick, report a snapshot
+  std::thread io([&]() {
+    unsigned long loopStart = 0;
+    while (!done.load()) {
+      cmdQueue.collect();
+
+      unsigned long now = uptime();
+      if (now - loopStart >= BENCH_TURN_TIME) {
+        loopStart = now;
+        s_command cmd;
+        while (cmdQueue.pop(cmd, now)) {
+          s_snapshot snap = { sSERVO, cmd.ActuatorId, (int16_t)cmd.Cmd, cmd.Value };
+          tlmQueue.push(snap);
+        }
+      }
+      taskDelay();
+    }
+  });
+
+  // netStep() : commands as mqttCallback would push them, publish snapshots
+  std::thread net([&]() {
+    const int64_t sendEnd = start + (int64_t)durationMs * 1000000;
+    const int64_t drainEnd = sendEnd + (int64_t)BENCH_DRAIN_MS * 1000000;
+    int64_t nextSend = start;
+
+    while (nowNs() < drainEnd) {
+      while (nowNs() < sendEnd && nowNs() >= nextSend) {
+        uint8_t id = run.Sent % BENCH_ACTUATORS;
+        int16_t value = (run.Sent / BENCH_ACTUATORS) % BENCH_VALUES;
+        s_command cmd = { id, cPOSITION, value };
+        sentNs[id][value] = nowNs();
+        lastSent[id] = value;
+        cmdQueue.push(cmd);
+        run.Sent++;
+        nextSend += (int64_t)intervalUs * 1000;
+      }
+
+      s_snapshot snap;
+      while (tlmQueue.pop(snap)) {
+        run.Snapshots++;
+        run.Latency.push_back(nowNs() - sentNs[snap.Id][snap.Value]);
+        lastApplied[snap.Id] = snap.Value;
+      }
+      taskDelay();
+    }
+    done.store(true);
+  });
+
+  net.join();
+  io.join();
+
+  run.LastKept = 0;
+  for (int i = 0; i < BENCH_ACTUATORS; i++) {
+    if (lastSent[i] >= 0 && lastApplied[i] == lastSent[i]) {
+      run.LastKept++;
+    }
+  }
+  run.Metrics = cmdQueue.getMetrics();
+  run.TlmDropped = tlmQueue.getDropped();
+}
+
+static void printRun(const char* name, s_benchRun& run) {
+  const s_cmdMetrics& m = run.Metrics;
+  printf("%-10s : %lu commands, %lu snapshots, applied %lu, coalesced %lu, rate limited %lu, queue full %lu, last target kept %d/%d\n",
+         name, run.Sent, run.Snapshots, (unsigned long)m.applied, (unsigned long)m.coalesced,
+         (unsigned long)m.rateLimited, (unsigned long)m.queueFull, run.LastKept, BENCH_ACTUATORS);
+  printf("%-10s   push -> snapshot : p50 %6.2f ms  p99 %6.2f ms  max %6.2f ms\n", "",
+         percentile(run.Latency, 0.50) / 1e6, percentile(run.Latency, 0.99) / 1e6, percentile(run.Latency, 1.0) / 1e6);
+}
+
+////////////////////////////////////////////////////////////////////////
+// 2. Paced : every command is applied, latency is set by the tick
+static bool benchPaced() {
+  s_benchRun run;
+  // One command per actuator every 250 ms, under CMDQUEUE_RATE
+  runSplit(250000 / BENCH_ACTUATORS, 4000, run);
+  printRun("paced", run);
+
+  return run.Snapshots == run.Sent && run.Metrics.rateLimited == 0 && run.Metrics.queueFull == 0 && run.TlmDropped == 0;
+}
+
+////////////////////////////////////////////////////////////////////////
+// 3. Flood : one command per ms, coalesced per actuator
+static bool benchFlood() {
+  s_benchRun run;
+  runSplit(1000, 1000, run);
+  printRun("flood", run);
+
+  return run.LastKept == BENCH_ACTUATORS && run.TlmDropped == 0;
+}
+
+int main() {
+  bool ok = benchThroughput();
+  ok = benchPaced() && ok;
+  ok = benchFlood() && ok;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,77 @@
+#!/bin/sh
+########################################################################
+# Firmware memory budget : RAM/flash footprint per object, per board profile
+# Needs arduino-cli with the esp8266 and esp32 cores installed.
+#
+# usage : tools/footprint.sh [profile ...]   (default : all profiles)
+#   profiles : vmc1 (ESP8266, __VMC1LR__), arroslr (ESP32, __ARROSLR__)
+#
+# For each profile, prints per sketch object : flash (text + data) and
+# RAM (data + bss), then the biggest RAM symbols of the firmware.
+########################################################################
+set -e
+
+SKETCH_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=${BUILD_DIR:-/tmp/domobj-footprint}
+TOP_SYMBOLS=${TOP_SYMBOLS:-20}
+
+profile_fqbn() {
+  case "$1" in
+    vmc1)    echo "esp8266:esp8266:nodemcuv2" ;;
+    arroslr) echo "esp32:esp32:esp32" ;;
+    *)       return 1 ;;
+  esac
+}
+
+profile_define() {
+  case "$1" in
+    vmc1)    echo "__VMC1LR__" ;;
+    arroslr) echo "__ARROSLR__" ;;
+  esac
+}
+
+# size/nm of the toolchain used for the build
+find_tool() {
+  find "${ARDUINO_DATA:-$HOME/.arduino15}/packages" -type f -name "xtensa-*-elf-$1" 2>/dev/null | grep "$2" | head -n 1
+}
+
+report() {
+  profile=$1
+  fqbn=$(profile_fqbn "$profile") || { echo "Unknown profile : $profile" >&2; exit 1; }
+  define=$(profile_define "$profile")
+  out="$BUILD_DIR/$profile"
+
+  arduino-cli compile --fqbn "$fqbn" --build-path "$out" \
+    --build-property "compiler.cpp.extra_flags=-D$define" \
+    "$SKETCH_DIR" > "$out.log" 2>&1 || { cat "$out.log" >&2; exit 1; }
+
+  case "$fqbn" in
+    esp8266:*) chip=lx106 ;;
+    *)         chip=esp32 ;;
+  esac
+  size=${SIZE:-$(find_tool size "$chip")}
+  nm=${NM:-$(find_tool nm "$chip")}
+
+  echo "== $profile ($fqbn, -D$define)"
+  printf "%-32s %8s %8s\n" "object" "flash" "ram"
+  for obj in "$out"/sketch/*.o; do
+    "$size" "$obj" | awk -v name="$(basename "$obj" .o)" 'NR == 2 {
+      printf "%-32s %8d %8d\n", name, $1 + $2, $2 + $3 }'
+  done
+
+  elf=$(ls "$out"/*.elf | head -n 1)
+  "$size" "$elf" | awk 'NR == 2 { printf "%-32s %8d %8d\n", "firmware", $1 + $2, $2 + $3 }'
+
+  echo "-- biggest RAM symbols"
+  "$nm" -C -S --size-sort "$elf" | awk '$3 ~ /^[bBdD]$/' | tail -n "$TOP_SYMBOLS" | \
+    while read addr symsize type name; do
+      printf "%8d %s\n" "0x$symsize" "$name"
+    done
+  echo
+}
+
+mkdir -p "$BUILD_DIR"
+[ $# -eq 0 ] && set -- vmc1 arroslr
+for p in "$@"; do
+  report "$p"
+done
@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+########################################################################
+# Decoder for the binary debug log published by DebugLog (s_logBatch)
+# Formats are read from LogFormats.h, so the firmware and the decoder
+# always agree on the format ids.
+#
+# usage : mosquitto_sub -h <broker> -t 'domobj/+/+/debug' -N | tools/logdecode.py
+#         tools/logdecode.py dump.bin [--formats path/to/LogFormats.h]
+########################################################################
+import argparse
+import os
+import re
+import struct
+import sys
+
+HEADER = struct.Struct("<BBHII")   # Version, Count, Reserved, Dropped, Suppressed
+RECORD = struct.Struct("<IBBBBii") # Time, Format, Level, Ring, Reserved, Args[2]
+LEVELS = "EWID"
+LOG_VERSION = 1
+
+
+def load_formats(path):
+    with open(path) as f:
+        text = f.read()
+    return [fmt for _, fmt in re.findall(r'X\((\w+),\s*"((?:[^"\\]|\\.)*)"\)', text)]
+
+
+def format_record(formats, time, fmt, level, ring, args):
+    text = formats[fmt] if fmt < len(formats) else "Unknown format %d %d"
+    conversions = len(re.findall(r"%[-+ 0#]*\d*[diuxX]", text))
+    try:
+        text = text % tuple(args[:conversions])
+    except (TypeError, ValueError):
+        text = "%s %r" % (text, args)
+    lvl = LEVELS[level] if level < len(LEVELS) else "?"
+    return "%10d %c [%d] %s" % (time, lvl, ring, text)
+
+
+def read_exact(stream, size):
+    data = b""
+    while len(data) < size:
+        chunk = stream.read(size - len(data))
+        if not chunk:
+            return None
+        data += chunk
+    return data
+
+
+def decode(stream, formats, out):
+    # Batches are decoded as they come, so a live mosquitto_sub can be piped in
+    losses = (0, 0)
+    while True:
+        header = read_exact(stream, HEADER.size)
+        if header is None:
+            return
+        version, count, _, dropped, suppressed = HEADER.unpack(header)
+        if version != LOG_VERSION:
+            sys.exit("Unknown log version %d" % version)
+        for _ in range(count):
+            record = read_exact(stream, RECORD.size)
+            if record is None:
+                sys.exit("Truncated batch")
+            time, fmt, level, ring, _, arg0, arg1 = RECORD.unpack(record)
+            out.write(format_record(formats, time, fmt, level, ring, [arg0, arg1]) + "\n")
+        if (dropped, suppressed) != losses: # totals since boot
+            losses = (dropped, suppressed)
+            out.write("%10s - dropped %d, suppressed %d\n" % ("", dropped, suppressed))
+        out.flush()
+
+
+def main():
+    default_formats = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "LogFormats.h")
+    parser = argparse.ArgumentParser(description="Decode DomObj binary debug log")
+    parser.add_argument("input", nargs="?", help="binary dump (default : stdin)")
+    parser.add_argument("--formats", default=default_formats, help="LogFormats.h")
+    args = parser.parse_args()
+
+    formats = load_formats(args.formats)
+    if args.input:
+        with open(args.input, "rb") as f:
+            decode(f, formats, sys.stdout)
+    else:
+        decode(sys.stdin.buffer, formats, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()